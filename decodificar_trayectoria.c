@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "trayectoria.h"
+
+// Convierte una trayectoria binaria (--salida=binaria) al formato de texto
+// de imprimir_estado, frame por frame.
+
+static const char* estado_to_str(unsigned char e) {
+    switch (e) {
+        case 0:  return "0";
+        case 1:  return "1";
+        case 2:  return "2";
+        default: return "?";
+    }
+}
+
+static void uso(const char *prog) {
+    fprintf(stderr,
+        "Uso: %s <trayectoria.tray>\n"
+        "Ej:  %s trayectoria.tray > salida.txt\n",
+        prog, prog
+    );
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        uso(argv[0]);
+        return 1;
+    }
+    Trayectoria t;
+    if (tray_abrir_lectura(&t, argv[1]) != 0) {
+        fprintf(stderr, "No se pudo leer la trayectoria %s\n", argv[1]);
+        return 1;
+    }
+    int *pos = (int*)malloc(sizeof(int) * (t.n_veh > 0 ? t.n_veh : 1));
+    unsigned char *estado = (unsigned char*)malloc(t.n_sem > 0 ? t.n_sem : 1);
+    if (!pos || !estado) {
+        fprintf(stderr, "Sin memoria para %d vehiculos\n", t.n_veh);
+        return 1;
+    }
+
+    int iter, r, frames = 0;
+    while ((r = tray_leer_frame(&t, &iter, pos, estado)) == 1) {
+        frames++;
+        printf("\nIteracion %d\n", iter + 1);
+        for (int i = 0; i < t.n_veh; i++) {
+            printf("Vehiculo %2d - Posicion: %d\n", i, pos[i]);
+        }
+        for (int j = 0; j < t.n_sem; j++) {
+            printf("Semaforo %d - Estado: %s\n", j, estado_to_str(estado[j]));
+        }
+    }
+    if (r < 0) fprintf(stderr, "Trayectoria truncada tras %d frames\n", frames);
+
+    free(pos);
+    free(estado);
+    tray_cerrar(&t);
+    return (r < 0) ? 1 : 0;
+}
@@ -1,271 +1,863 @@
-#include <stdio.h>
+// Línea de comandos de la simulación: todos los motores, salida por tick,
+// benchmark, conjunto de semillas, optimizador, puntos de control y escenarios.
+// Los modos usan los motores por dentro a través de trafico_interno.h:
+//   gcc -O2 -fopenmp simulacion_paralela.c trafico.c -o simulacion_paralela
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <omp.h>
+#include "trafico_interno.h"
 
 #if defined(_WIN32) || defined(_WIN64)
-  #include <windows.h>
-  #define SLEEP_SEC(x) Sleep((x) * 1000)
+  #include <process.h>
+  #define PONER_ENV(k, v) _putenv_s(k, v)
+  #define REEJECUTAR(argv) _execvp((argv)[0], (const char * const *)(argv))
 #else
   #include <unistd.h>
-  #define SLEEP_SEC(x) sleep(x)
+  #define PONER_ENV(k, v) setenv(k, v, 1)
+  #define REEJECUTAR(argv) execvp((argv)[0], (argv))
 #endif
 
-// -------------------- Estructuras --------------------
-typedef enum {
-    ROJO = 0,
-    VERDE = 1,
-    AMARILLO = 2
-} EstadoSemaforo;
-
-typedef struct {
-    int id;
-    int pos;            // posición sobre una carretera 1D [0, road_len)
-    EstadoSemaforo estado;
-    int t_en_estado;    // tiempo transcurrido en el estado actual (ticks)
-    // Duraciones configurables por estado:
-    int dur_rojo;
-    int dur_verde;
-    int dur_amarillo;
-} Semaforo;
-
-typedef struct {
-    int id;
-    int pos;        // posición actual
-    int vel_max;    // velocidad máxima (celdas por tick)
-} Vehiculo;
-
-typedef struct {
-    int largo;          // largo de la carretera (bucle 1D)
-    Vehiculo *vehiculos;
-    int n_veh;
-    Semaforo *semaforos;
-    int n_sem;
-} Interseccion; 
-
-// -------------------- Utilidades --------------------
-static inline int mod_pos(int x, int m) {
-    int r = x % m;
-    return (r < 0) ? r + m : r;
+// Corrida del motor compacto; recibe cantidad y largo de 64 bits aparte porque
+// Corrida (y el resto de los motores) son de 32 bits.
+static double correr_compacto(int64_t n_veh, int64_t road_len, int iters, Semaforo *sem, int n_sem,
+                              unsigned int seed, int delay, Salida *out, Metricas *met) {
+    VehiculosCompactos vc;
+    if (trafico_crear_vehiculos_compactos(&vc, n_veh, road_len, seed) != 0) {
+        fprintf(stderr, "Sin memoria para %lld vehiculos compactos\n", (long long)n_veh);
+        return -1.0;
+    }
+    double t0 = omp_get_wtime();
+    trafico_simular_compacto(iters, &vc, sem, n_sem, road_len, delay, out, met);
+    double t = omp_get_wtime() - t0;
+    trafico_liberar_vehiculos_compactos(&vc);
+    return t;
+}
+// Conjunto de semillas: la tabla por semilla va a ruta_csv (o a stdout)
+static double correr_conjunto(int iters, int n_veh, const Semaforo *sem, int n_sem, const int *celda_sem, int road_len,
+                              const unsigned int *semillas, int n_rep, const char *ruta_csv, Metricas *met) {
+    Conjunto cj;
+    if (trafico_crear_conjunto(&cj, semillas, n_rep, n_veh, road_len) != 0) {
+        fprintf(stderr, "Sin memoria para %d replicas de %d vehiculos\n", n_rep, n_veh);
+        return -1.0;
+    }
+    double t0 = omp_get_wtime();
+    if (trafico_simular_conjunto(iters, &cj, sem, n_sem, celda_sem, road_len, met) != 0) {
+        trafico_liberar_conjunto(&cj);
+        return -1.0;
+    }
+    double t = omp_get_wtime() - t0;
+    FILE *csv = ruta_csv ? fopen(ruta_csv, "w") : stdout;
+    if (!csv) {
+        fprintf(stderr, "No se pudo crear %s\n", ruta_csv);
+        trafico_liberar_conjunto(&cj);
+        return -1.0;
+    }
+    trafico_reportar_conjunto(&cj, iters, csv);
+    if (csv != stdout) fclose(csv);
+    trafico_liberar_conjunto(&cj);
+    return t;
 }
 
-static inline const char* estado_to_str(EstadoSemaforo e) {
-    switch (e) {
-        case ROJO:     return "0";
-        case VERDE:    return "1";
-        case AMARILLO: return "2";
-        default:       return "?";
+// Optimizador: parte del plan de sem, lo deja en el mejor y lo escribe en ruta
+static double correr_optimizador(int iters, const Vehiculo *veh, int n_veh, Semaforo *sem, int n_sem, const int *celda_sem,
+                                 int road_len, int n_cand, int rondas, int paradas, int repartos, unsigned int seed,
+                                 const char *ruta) {
+    VehiculosSoA vs;
+    if (trafico_crear_vehiculos_soa(&vs, n_veh) != 0) {
+        fprintf(stderr, "Sin memoria para %d vehiculos\n", n_veh);
+        return -1.0;
+    }
+    trafico_vehiculos_a_soa(veh, &vs);
+    Puntaje mejor;
+    double t0 = omp_get_wtime();
+    int r = trafico_optimizar_plan(sem, n_sem, celda_sem, &vs, road_len, iters, n_cand, rondas, paradas, repartos, seed, &mejor);
+    double t = omp_get_wtime() - t0;
+    if (r != 0) {
+        fprintf(stderr, "Sin memoria para puntuar %d candidatos\n", n_cand);
+        trafico_liberar_vehiculos_soa(&vs);
+        return -1.0;
     }
+    char titulo[160];
+    snprintf(titulo, sizeof(titulo), "Plan optimizado (%s): avance %lld, detenidos %lld en %d ticks",
+             paradas ? "paradas" : "flujo", mejor.avance, mejor.detenidos, iters);
+    if (trafico_escribir_escenario_texto(ruta, titulo, road_len, sem, n_sem, &vs) != 0) {
+        fprintf(stderr, "No se pudo escribir el escenario %s\n", ruta);
+        t = -1.0;
+    } else {
+        printf("Escenario escrito en %s\n", ruta);
+    }
+    trafico_liberar_vehiculos_soa(&vs);
+    return t;
+}
+
+// -------------------- Ubicación NUMA --------------------
+// Con --numa cada hilo queda fijo a un lugar y el equipo no cambia de tamaño en
+// toda la corrida, así que el hilo t de cada región corre siempre en el mismo
+// lugar. Las inicializaciones recorren Vehiculo[], Semaforo[], celda_sem, los
+// SoA y estado_celda con schedule(static), igual que los motores: el primer
+// toque deja cada tramo en el nodo del hilo que después lo actualiza.
+// El runtime sólo lee OMP_PLACES/OMP_PROC_BIND al arrancar: si no están
+// definidos se fijan y el programa se relanza a sí mismo.
+static void preparar_numa(char **argv) {
+    if (omp_get_num_places() > 0 || getenv("OMP_PLACES") || getenv("OMP_PROC_BIND")) return;
+    PONER_ENV("OMP_PLACES", "cores");
+    PONER_ENV("OMP_PROC_BIND", "spread");
+    fflush(stdout);
+    REEJECUTAR(argv);
+    fprintf(stderr, "No se pudo relanzar con OMP_PLACES=cores OMP_PROC_BIND=spread: hilos sin fijar\n");
 }
-// -------------------- Inicialización --------------------
-void inicializar_vehiculos(Vehiculo *v, int n, int road_len, unsigned int seed) {
-    // Distribuir vehículos de forma pseudoaleatoria no superpuesta y velocidad 1–2
-    srand(seed);
-    // Para evitar muchas colisiones iniciales, ubicamos espaciados con jitter
-    int espacio = (road_len > n) ? (road_len / n) : 1;
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < n; i++) {
-        int jitter = (espacio > 1) ? (rand() % espacio) : 0;
-        v[i].id = i;
-        v[i].pos = mod_pos(i * espacio + jitter, road_len);
-        v[i].vel_max = 1 + (rand() % 2); // 1 o 2
+
+static const char *nombre_proc_bind(omp_proc_bind_t b) {
+    switch (b) {
+        case omp_proc_bind_false:  return "false";
+        case omp_proc_bind_true:   return "true";
+        case omp_proc_bind_master: return "master";
+        case omp_proc_bind_close:  return "close";
+        case omp_proc_bind_spread: return "spread";
+        default:                   return "?";
     }
 }
 
-void inicializar_semaforos(Semaforo *s, int n, int road_len, int ciclo_total) {
-    // Colocar semáforos espaciados a lo largo de la carretera.
-    // Ajuste de ciclo: verde > amarillo > rojo
-    int espacio = (road_len > n) ? (road_len / n) : 1;
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < n; i++) {
-        s[i].id = i;
-        s[i].pos = mod_pos(i * espacio, road_len);
-        s[i].estado = (i % 2 == 0) ? VERDE : ROJO; // alternar para variedad
-        s[i].t_en_estado = 0;
-
-        // Duraciones proporcionales al ciclo total
-        s[i].dur_verde    = (int)(ciclo_total * 0.5); // 50%
-        s[i].dur_amarillo = (int)(ciclo_total * 0.2); // 20%
-        s[i].dur_rojo     = ciclo_total - s[i].dur_verde - s[i].dur_amarillo;
-        if (s[i].dur_verde < 1) s[i].dur_verde = 1;
-        if (s[i].dur_amarillo < 1) s[i].dur_amarillo = 1;
-        if (s[i].dur_rojo < 1) s[i].dur_rojo = 1;
+// Lugar de cada hilo de un equipo como el de los motores, y sus procesadores
+void reportar_topologia(void) {
+    int n = omp_get_max_threads();
+    int *lugar = (int*)malloc(sizeof(int) * n);
+    if (!lugar) return;
+    for (int t = 0; t < n; t++) lugar[t] = -1;
+    #pragma omp parallel
+    lugar[omp_get_thread_num()] = omp_get_place_num();
+
+    printf("NUMA: proc_bind=%s | lugares: %d | hilos: %d\n",
+           nombre_proc_bind(omp_get_proc_bind()), omp_get_num_places(), n);
+    for (int t = 0; t < n; t++) {
+        printf("  hilo %d -> lugar %d", t, lugar[t]);
+        int np = (lugar[t] >= 0) ? omp_get_place_num_procs(lugar[t]) : 0;
+        int *ids = (np > 0) ? (int*)malloc(sizeof(int) * np) : NULL;
+        if (ids) {
+            omp_get_place_proc_ids(lugar[t], ids);
+            printf(" (procesadores");
+            for (int k = 0; k < np; k++) printf(" %d", ids[k]);
+            printf(")");
+            free(ids);
+        }
+        printf("\n");
     }
+    free(lugar);
 }
+// -------------------- Main, pruebas y opciones --------------------
+// Parámetros de una corrida, para poder lanzarla al lado del hilo escritor
+typedef struct {
+    const char *motor;
+    int iters;
+    int n_veh;
+    int n_sem;
+    int road;
+    int delay;
+    int usar_secciones;
+    Vehiculo *veh;
+    Semaforo *sem;
+    int *celda_sem;
+    Metricas *met;      // NULL sin --reporte
+    unsigned int seed;
+    double frenado;     // probabilidad de frenado del motor con exclusión
+    int reordenar;      // periodo de medición de desorden en soa/analitico (0: nunca)
+    int numa;           // hilos fijos: sin ajuste dinámico en el motor clásico
+    int carriles;       // con exclusion y más de 1, trafico_simular_carriles
+    int red_filas, red_cols;    // grilla de --motor=red
+    PuntoControl *pc;   // puntos de control y reanudación del motor clásico (o NULL)
+    long long *cambios_carril;  // con carriles, total de la corrida (o NULL)
+} Corrida;
+
+static const char *MOTORES[] = { "clasico", "persistente", "soa", "analitico", "eventos", "exclusion", "dominios", "compacto", "red", NULL };
 
-// -------------------- Semáforos --------------------
-static inline EstadoSemaforo siguiente_estado(const Semaforo *s) {
-    switch (s->estado) {
-        case VERDE:    return AMARILLO;
-        case AMARILLO: return ROJO;
-        case ROJO:     return VERDE;
-        default:       return ROJO;
+static int motor_valido(const char *motor) {
+    for (int k = 0; MOTORES[k]; k++) {
+        if (strcmp(motor, MOTORES[k]) == 0) return 1;
     }
+    return 0;
 }
 
-void actualizar_semaforos(Semaforo *s, int n) {
-    // Paralelizar por semáforo
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < n; i++) {
-        s[i].t_en_estado++;
-        int limite = 0;
-        switch (s[i].estado) {
-            case VERDE:    limite = s[i].dur_verde;    break;
-            case AMARILLO: limite = s[i].dur_amarillo; break;
-            case ROJO:     limite = s[i].dur_rojo;     break;
-            default:       limite = 1;                 break;
+// Ejecuta el motor elegido y devuelve el tiempo de simulación en segundos
+static double correr_motor(const Corrida *c, Salida *out) {
+    double t0 = omp_get_wtime();
+    int analitico = (strcmp(c->motor, "analitico") == 0);
+    int eventos = (strcmp(c->motor, "eventos") == 0);
+    int exclusion = (strcmp(c->motor, "exclusion") == 0);
+    if (strcmp(c->motor, "red") == 0) {
+        Red r;
+        if (trafico_crear_red_grilla(&r, c->red_filas, c->red_cols, c->road, c->n_veh, &c->sem[0], c->seed) != 0) {
+            fprintf(stderr, "Sin memoria para la red %dx%d\n", c->red_filas, c->red_cols);
+            return -1.0;
         }
-        if (s[i].t_en_estado >= limite) {
-            s[i].estado = siguiente_estado(&s[i]);
-            s[i].t_en_estado = 0;
+        t0 = omp_get_wtime();
+        int ok = (trafico_simular_red(c->iters, &r, c->seed, c->delay, out, c->met) == 0);
+        double t = omp_get_wtime() - t0;
+        trafico_liberar_red(&r);
+        return ok ? t : -1.0;
+    }
+    if (strcmp(c->motor, "compacto") == 0) {
+        return correr_compacto(c->n_veh, c->road, c->iters, c->sem, c->n_sem, c->seed, c->delay, out, c->met);
+    }
+    long long capacidad = (long long)c->road * (c->carriles > 1 ? c->carriles : 1);
+    if (exclusion && c->n_veh > capacidad) {
+        fprintf(stderr, "Con exclusion no caben %d vehiculos en %lld celdas\n", c->n_veh, capacidad);
+        return -1.0;
+    }
+    if (exclusion && c->carriles > 1) {
+        // Las posiciones se reparten sobre todos los carriles (ver trafico_simular_carriles)
+        trafico_inicializar_vehiculos(c->veh, c->n_veh, (int)capacidad, c->seed);
+        t0 = omp_get_wtime();
+        long long cambios = trafico_simular_carriles(c->iters, c->veh, c->n_veh, c->carriles, c->sem, c->n_sem, c->celda_sem,
+                                                     c->road, c->delay, c->frenado, c->seed, out, c->met);
+        if (cambios < 0) return -1.0;
+        if (c->cambios_carril) *c->cambios_carril = cambios;
+        return omp_get_wtime() - t0;
+    }
+    if (analitico || eventos || exclusion || strcmp(c->motor, "soa") == 0) {
+        VehiculosSoA vs;
+        if (trafico_crear_vehiculos_soa(&vs, c->n_veh) != 0) {
+            fprintf(stderr, "Sin memoria para %d vehiculos\n", c->n_veh);
+            return -1.0;
+        }
+        trafico_vehiculos_a_soa(c->veh, &vs);
+        OrdenVehiculos orden;
+        OrdenVehiculos *ord = NULL;
+        if (c->reordenar > 0 && (analitico || strcmp(c->motor, "soa") == 0)) {
+            if (trafico_crear_orden_vehiculos(&orden, &vs, c->reordenar) != 0) {
+                fprintf(stderr, "Sin memoria para reordenar %d vehiculos\n", c->n_veh);
+                trafico_liberar_vehiculos_soa(&vs);
+                return -1.0;
+            }
+            ord = &orden;
+        }
+        t0 = omp_get_wtime();
+        if (exclusion) {
+            trafico_simular_exclusion(c->iters, &vs, c->sem, c->n_sem, c->celda_sem, c->road, c->delay, c->frenado, c->seed, out, c->met);
+        } else if (eventos) {
+            trafico_simular_eventos(c->iters, &vs, c->sem, c->n_sem, c->celda_sem, c->road, c->delay, out, c->met);
+        } else if (analitico) {
+            trafico_simular_analitico(c->iters, &vs, c->sem, c->n_sem, c->celda_sem, c->road, c->delay, ord, out, c->met);
+        } else {
+            trafico_simular_soa(c->iters, &vs, c->sem, c->n_sem, c->celda_sem, c->road, c->delay, ord, out, c->met);
+        }
+        if (ord) trafico_liberar_orden_vehiculos(ord);
+        trafico_liberar_vehiculos_soa(&vs);
+    } else if (strcmp(c->motor, "dominios") == 0) {
+        trafico_simular_dominios(c->iters, c->veh, c->n_veh, c->sem, c->n_sem, c->celda_sem, c->road, c->delay, out, c->met);
+    } else if (strcmp(c->motor, "persistente") == 0) {
+        trafico_simular_persistente(c->iters, c->veh, c->n_veh, c->sem, c->n_sem, c->celda_sem, c->road, c->delay, c->usar_secciones, out, c->met);
+    } else {
+        if (trafico_simular_dinamico(c->iters, c->veh, c->n_veh, c->sem, c->n_sem, c->celda_sem, c->road, c->delay,
+                                     c->usar_secciones, !c->numa, c->pc, out, c->met) != 0) {
+            fprintf(stderr, "Sin memoria para el estado de %d semaforos\n", c->n_sem);
+            return -1.0;
         }
     }
+    return omp_get_wtime() - t0;
 }
-// -------------------- Vehículos (lógica de movimiento) --------------------
-// Regla simple: un vehículo avanza hasta su vel_max salvo que el siguiente semáforo
-// por delante esté en ROJO o AMARILLO exactamente en su posición destino (o antes).
-// Para robustez un "stop range" = 0 (la celda del semáforo).
-// Btw usamos snapshot de semáforos para evitar leer mientras se actualizan.
-void mover_vehiculos(Vehiculo *v, int n_veh, const Semaforo *sem_snapshot, int n_sem, int road_len) {
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < n_veh; i++) {
-        int pos_actual = v[i].pos;
-        int paso = v[i].vel_max;
-        int puede_mover = 1;
-
-        // Calcular posición destino tentativa
-        int destino = mod_pos(pos_actual + paso, road_len);
-
-        // Verificar semáforo en destino
-        for (int j = 0; j < n_sem; j++) {
-            // Si hay semáforo justo en la celda de destino y no está VERDE, detente
-            if (sem_snapshot[j].pos == destino) {
-                if (sem_snapshot[j].estado == ROJO || sem_snapshot[j].estado == AMARILLO) {
-                    puede_mover = 0;
-                }
-                break;
+
+// Con anillo de salida o puntos de control asíncronos: un equipo con un hilo
+// más por cada uno. El 0 simula (sus regiones paralelas quedan anidadas un
+// nivel más abajo) y los demás escriben frames o puntos de control.
+static double correr_con_escritor(const Corrida *c, Salida *out) {
+    PuntoControl *pc = (c->pc && c->pc->cada > 0) ? c->pc : NULL;
+    int escritores = (out->cola.capacidad > 0) + (pc != NULL);
+    if (escritores == 0) return correr_motor(c, out);
+
+    double t = 0.0;
+    int niveles = omp_get_max_active_levels();
+    if (niveles < omp_get_supported_active_levels()) omp_set_max_active_levels(niveles + 1);
+    int sincrono = 0;
+    #pragma omp parallel num_threads(1 + escritores)
+    {
+        #pragma omp single
+        {
+            // Sin hilos de más no hay quién drene: salida y puntos de control síncronos
+            sincrono = (omp_get_num_threads() < 1 + escritores);
+            if (pc) pc->asincrono = !sincrono;
+        }
+        int h = omp_get_thread_num();
+        if (sincrono) {
+            if (h == 0) {
+                trafico_liberar_cola_salida(out);   // deja capacidad = 0: trafico_emitir_estado escribe directo
+                t = correr_motor(c, out);
             }
+        } else if (h == 0) {
+            t = correr_motor(c, out);
+            trafico_cerrar_cola_salida(out);
+            if (pc) trafico_cerrar_punto_control(pc);
+        } else if (h == 1 && out->cola.capacidad > 0) {
+            trafico_drenar_cola_salida(out);
+        } else {
+            trafico_escribir_puntos_control(pc);
         }
-
-        if (puede_mover) {
-            v[i].pos = destino;
-        } // si no puede, se queda en su lugar
     }
+    omp_set_max_active_levels(niveles);
+    return t;
 }
-// -------------------- Bucle de simulación --------------------
-void imprimir_estado(const Vehiculo *v, int n_veh, const Semaforo *s, int n_sem, int iter) {
-    printf("\nIteracion %d\n", iter + 1);
-    for (int i = 0; i < n_veh; i++) {
-        printf("Vehiculo %2d - Posicion: %d\n", v[i].id, v[i].pos);
-    }
-    for (int j = 0; j < n_sem; j++) {
-        printf("Semaforo %d - Estado: %s\n", s[j].id, estado_to_str(s[j].estado));
+
+// Busca "--clave=valor" en cualquier posición. "--clave" sin valor equivale a "1".
+static const char* opcion(int argc, char **argv, const char *clave) {
+    size_t n = strlen(clave);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0 || strncmp(argv[i] + 2, clave, n) != 0) continue;
+        if (argv[i][2 + n] == '=') return argv[i] + 3 + n;
+        if (argv[i][2 + n] == '\0') return "1";
     }
+    return NULL;
 }
 
-void simular_simple(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, int road_len, int delay_seg) {
-    for (int i = 0; i < iteraciones; i++) {
-        // Actualizar semáforos
-        actualizar_semaforos(s, n_sem);
-
-        // Snapshot de semáforos para que el movimiento lea un estado estable
-        Semaforo *snap = (Semaforo*)malloc(sizeof(Semaforo) * n_sem);
-        memcpy(snap, s, sizeof(Semaforo) * n_sem);
+// -------------------- Benchmark --------------------
+// Barrido de hilos x vehículos x semáforos x largo con salida desactivada.
+// Cada punto se repite (con corridas de calentamiento descartadas) y se toma
+// la mediana. La referencia es trafico_simular_simple con 1 hilo en el mismo tamaño.
+#define MAX_LISTA 32
 
-        // Mover vehículos
-        mover_vehiculos(v, n_veh, snap, n_sem, road_len);
+// Lee "a,b,c" en vals; devuelve cuántos valores leyó (0 si alguno es inválido)
+static int leer_lista(const char *txt, int *vals, int max) {
+    int n = 0;
+    while (txt && *txt && n < max) {
+        char *fin;
+        long x = strtol(txt, &fin, 10);
+        if (fin == txt || x <= 0) return 0;
+        vals[n++] = (int)x;
+        txt = (*fin == ',') ? fin + 1 : fin;
+        if (*fin != ',' && *fin != '\0') return 0;
+    }
+    return n;
+}
 
-        free(snap);
+static int comparar_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
 
-        // Mostrar estado
-        imprimir_estado(v, n_veh, s, n_sem, i);
+// Mediana de `reps` corridas (tras `calentamiento` descartadas) de un motor.
+// motor = NULL mide la referencia: trafico_simular_simple.
+static double medir_punto(const char *motor, int hilos, int n_veh, int n_sem, int road, int iters,
+                          int ciclo, unsigned int seed, int reps, int calentamiento) {
+    Vehiculo *veh = (Vehiculo*)malloc(sizeof(Vehiculo) * n_veh);
+    Semaforo *sem = (Semaforo*)malloc(sizeof(Semaforo) * n_sem);
+    int *celda_sem = (int*)malloc(sizeof(int) * road);
+    double *tiempos = (double*)malloc(sizeof(double) * reps);
+    if (!veh || !sem || !celda_sem || !tiempos) {
+        free(veh); free(sem); free(celda_sem); free(tiempos);
+        return -1.0;
+    }
+    Salida nula;
+    memset(&nula, 0, sizeof(nula));
+    nula.tipo = SALIDA_NINGUNA;
 
-        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+    for (int r = -calentamiento; r < reps; r++) {
+        // trafico_simular_dinamico cambia el ajuste dinámico y el número de hilos: restaurar
+        omp_set_dynamic(0);
+        omp_set_num_threads(hilos);
+        trafico_inicializar_vehiculos(veh, n_veh, road, seed);
+        trafico_inicializar_semaforos(sem, n_sem, road, ciclo, celda_sem);
+        double t;
+        if (motor) {
+            // numa = 1: el motor clásico corre con el equipo fijo de hilos pedido
+            // en lugar de su ajuste dinámico, así cada fila mide los hilos que dice
+            Corrida c = { motor, iters, n_veh, n_sem, road, 0, 1, veh, sem, celda_sem, NULL, seed, 0.0, 0, 1, 1, 8, 8, NULL, NULL };
+            t = correr_motor(&c, &nula);
+        } else {
+            double t0 = omp_get_wtime();
+            int ok = (trafico_simular_simple(iters, veh, n_veh, sem, n_sem, celda_sem, road, 0, &nula, NULL) == 0);
+            t = ok ? omp_get_wtime() - t0 : -1.0;
+        }
+        if (t < 0) {
+            free(veh); free(sem); free(celda_sem); free(tiempos);
+            return -1.0;
+        }
+        if (r >= 0) tiempos[r] = t;
     }
+    qsort(tiempos, reps, sizeof(double), comparar_double);
+    double mediana = (reps % 2) ? tiempos[reps / 2] : 0.5 * (tiempos[reps / 2 - 1] + tiempos[reps / 2]);
+    free(veh); free(sem); free(celda_sem); free(tiempos);
+    return mediana;
 }
-// -------------------- Ajuste dinámico de hilos --------------------
-void simular_dinamico(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, int road_len, int delay_seg, int usar_secciones) {
-    omp_set_dynamic(1); // permitir ajuste dinámico
-    omp_set_num_threads(8);
-    for (int i = 0; i < iteraciones; i++) {
-        if (usar_secciones) {
-            // Snapshot previo para que la sección de "mover" lea un estado consistente
-            Semaforo *snap = (Semaforo*)malloc(sizeof(Semaforo) * n_sem);
-            memcpy(snap, s, sizeof(Semaforo) * n_sem);
-
-            #pragma omp parallel sections
-            {
-                #pragma omp section
-                {
-                    actualizar_semaforos(s, n_sem);
-                }
-                #pragma omp section
-                {
-                    mover_vehiculos(v, n_veh, snap, n_sem, road_len);
-                }
-            }
-            free(snap);
-        } else {
-            // Secuencial por iteración (pero cada tarea interna está paralelizada)
-            actualizar_semaforos(s, n_sem);
 
-            Semaforo *snap = (Semaforo*)malloc(sizeof(Semaforo) * n_sem);
-            memcpy(snap, s, sizeof(Semaforo) * n_sem);
+static int benchmark(int argc, char **argv) {
+    int hilos[MAX_LISTA], vehs[MAX_LISTA], sems[MAX_LISTA], largos[MAX_LISTA];
+    const char *h = opcion(argc, argv, "hilos");
+    const char *v = opcion(argc, argv, "vehiculos");
+    const char *sm = opcion(argc, argv, "semaforos");
+    const char *l = opcion(argc, argv, "largos");
+    int n_h = leer_lista(h ? h : "1,2,4,8", hilos, MAX_LISTA);
+    int n_v = leer_lista(v ? v : "100000", vehs, MAX_LISTA);
+    int n_s = leer_lista(sm ? sm : "1000", sems, MAX_LISTA);
+    int n_l = leer_lista(l ? l : "1000000", largos, MAX_LISTA);
+    const char *o;
+    int iters = (o = opcion(argc, argv, "iteraciones")) ? atoi(o) : 100;
+    int reps  = (o = opcion(argc, argv, "reps")) ? atoi(o) : 5;
+    int calentamiento = (o = opcion(argc, argv, "calentamiento")) ? atoi(o) : 1;
+    int ciclo = (o = opcion(argc, argv, "ciclo")) ? atoi(o) : 9;
+    unsigned int seed = (o = opcion(argc, argv, "seed")) ? (unsigned int)strtoul(o, NULL, 10) : 42u;
+    int debil = (opcion(argc, argv, "debil") != NULL);
+    const char *motor = opcion(argc, argv, "motor");
+    if (!motor) motor = "persistente";
+    if (!n_h || !n_v || !n_s || !n_l || iters <= 0 || reps <= 0 || calentamiento < 0 ||
+        !motor_valido(motor)) {
+        fprintf(stderr, "Opciones de benchmark invalidas\n");
+        return 1;
+    }
+    const char *ruta = opcion(argc, argv, "csv");
+    FILE *csv = ruta ? fopen(ruta, "w") : stdout;
+    if (!csv) {
+        fprintf(stderr, "No se pudo crear %s\n", ruta);
+        return 1;
+    }
 
-            mover_vehiculos(v, n_veh, snap, n_sem, road_len);
-            free(snap);
+    fprintf(csv, "motor,isa,escalado,hilos,vehiculos,semaforos,largo,iteraciones,t_base_s,t_s,"
+                 "actualizaciones_por_s,speedup,eficiencia\n");
+    for (int a = 0; a < n_v; a++)
+    for (int b = 0; b < n_s; b++)
+    for (int c = 0; c < n_l; c++) {
+        // Referencia por tamaño base; en escalado débil la carga crece con los hilos
+        // y cada punto se compara con la referencia de su mismo tamaño.
+        double t_base_fijo = debil ? 0.0 : medir_punto(NULL, 1, vehs[a], sems[b], largos[c], iters, ciclo, seed, reps, calentamiento);
+        for (int k = 0; k < n_h; k++) {
+            long long escala = debil ? hilos[k] : 1;
+            long long nv_64 = vehs[a] * escala, ns_64 = sems[b] * escala, nl_64 = largos[c] * escala;
+            if (nv_64 > INT_MAX || ns_64 > INT_MAX || nl_64 > INT_MAX) {
+                fprintf(stderr, "%lld vehiculos, %lld semaforos o largo %lld no entran en int\n", nv_64, ns_64, nl_64);
+                continue;
+            }
+            int nv = (int)nv_64, ns = (int)ns_64, nl = (int)nl_64;
+            if (nl <= 2) continue;
+            double t_base = debil ? medir_punto(NULL, 1, nv, ns, nl, iters, ciclo, seed, reps, calentamiento) : t_base_fijo;
+            double t = medir_punto(motor, hilos[k], nv, ns, nl, iters, ciclo, seed, reps, calentamiento);
+            if (t_base < 0 || t < 0) {
+                fprintf(stderr, "Sin memoria para %d vehiculos / largo %d\n", nv, nl);
+                continue;
+            }
+            double speedup = (t > 0) ? t_base / t : 0.0;
+            fprintf(csv, "%s,%s,%s,%d,%d,%d,%d,%d,%.9f,%.9f,%.3f,%.4f,%.4f\n",
+                    motor, trafico_isa(), debil ? "debil" : "fuerte", hilos[k], nv, ns, nl, iters, t_base, t,
+                    (t > 0) ? (double)nv * iters / t : 0.0, speedup, speedup / hilos[k]);
+            fflush(csv);
         }
+    }
+    if (csv != stdout) fclose(csv);
+    return 0;
+}
 
-        imprimir_estado(v, n_veh, s, n_sem, i);
-        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+// Lee "a-b" (rango inclusivo) o "a,b,c" en una lista nueva de semillas;
+// devuelve cuántas leyó (0 si el texto es inválido o no hay memoria)
+#define MAX_SEMILLAS (1 << 20)
+// Una semilla en txt: sólo dígitos (strtoul aceptaría signo y espacios) y
+// que entre en unsigned int; deja en *fin lo que sigue. 0 si es válida.
+static int leer_semilla(const char *txt, char **fin, unsigned long *x) {
+    if (*txt < '0' || *txt > '9') return -1;
+    *x = strtoul(txt, fin, 10);
+    return (*x > UINT_MAX) ? -1 : 0;
+}
+
+static int leer_semillas(const char *txt, unsigned int **semillas) {
+    char *fin;
+    unsigned long a, b;
+    if (leer_semilla(txt, &fin, &a) != 0) return 0;
+    if (*fin == '-') {
+        const char *b_txt = fin + 1;
+        if (leer_semilla(b_txt, &fin, &b) != 0 || *fin != '\0' || b < a || b - a >= MAX_SEMILLAS) return 0;
+        *semillas = (unsigned int*)malloc(sizeof(unsigned int) * (b - a + 1));
+        if (!*semillas) return 0;
+        for (unsigned long x = a; x <= b; x++) (*semillas)[x - a] = (unsigned int)x;
+        return (int)(b - a + 1);
+    }
+    int n = 1;
+    for (const char *p = txt; *p; p++) n += (*p == ',');
+    if (n > MAX_SEMILLAS) return 0;
+    *semillas = (unsigned int*)malloc(sizeof(unsigned int) * n);
+    if (!*semillas) return 0;
+    for (int k = 0; k < n; k++) {
+        if (leer_semilla(txt, &fin, &a) != 0 || (*fin != ',' && *fin != '\0')) {
+            free(*semillas);
+            *semillas = NULL;
+            return 0;
+        }
+        (*semillas)[k] = (unsigned int)a;
+        txt = fin + 1;
     }
+    return n;
 }
-// -------------------- Main, pruebas y opciones --------------------
+
 static void uso(const char *prog) {
     fprintf(stderr,
-        "Uso: %s <vehiculos> <semaforos> <iteraciones> <largo_carretera> [delay_seg=0] [ciclo_semaforo=9] [usar_secciones=1] [seed]\n"
-        "Ej:  %s 20 4 5 100 0 9 1 42\n",
-        prog, prog
+        "Uso: %s <vehiculos> <semaforos> <iteraciones> <largo_carretera> [delay_seg=0] [ciclo_semaforo=9] [usar_secciones=1] [seed] [opciones]\n"
+        "Ej:  %s 20 4 5 100 0 9 1 42\n"
+        "Opciones:\n"
+        "  --motor=clasico|persistente|soa|analitico|eventos|exclusion|dominios|compacto|red\n"
+        "      clasico: trafico_simular_dinamico con Vehiculo[] (por defecto)\n"
+        "      persistente: una sola region paralela para toda la corrida\n"
+        "      soa: arreglos separados y kernel vectorizado\n"
+        "      analitico: estado de semaforos en forma cerrada, sin fase de semaforos\n"
+        "      eventos: cada vehiculo salta de semaforo en semaforo hasta el tick emitido\n"
+        "      exclusion: una celda por vehiculo, paso limitado por el hueco (requiere vehiculos <= largo)\n"
+        "      dominios: la carretera en tramos por hilo, traspaso de vehiculos entre tramos\n"
+        "      compacto: posiciones de 1/2/4/8 bytes, vel de 1 byte, estado de celda de 2 bits;\n"
+        "        con largo o vehiculos >= 2^31 se elige solo, con indices de 64 bits y sin salida\n"
+        "      red: grilla de calles con cruces (ver --red), paralelo por calle\n"
+        "  --frenado=p                      con exclusion, probabilidad de frenar un paso (0)\n"
+        "  --carriles=K                     con exclusion, K carriles con cambio de carril (1); la\n"
+        "                                   salida da cada vehiculo como carril * largo + celda\n"
+        "  --red=FxC                        con --motor=red, ciudad de F x C cruces (8x8); cada cruce\n"
+        "                                   tiene 4 calles salientes de largo_carretera celdas con un\n"
+        "                                   semaforo al final, y la salida numera las calles seguidas\n"
+        "  --semillas=a-b|a,b,c             corre el escenario una vez por semilla en un solo proceso\n"
+        "                                   (nucleo analitico, sin salida por tick) y da por semilla\n"
+        "                                   avance, velocidad media y fraccion detenida\n"
+        "  --csv=ruta                       con --semillas, destino de la tabla por semilla (stdout)\n"
+        "  --optimizar=ruta.txt             busca desfases de semaforos (onda verde) puntuando candidatos\n"
+        "                                   en paralelo y escribe el mejor plan como escenario de texto\n"
+        "                                   (sin salida por tick ni --reporte)\n"
+        "  --objetivo=flujo|paradas         con --optimizar, maximiza el avance o minimiza detenciones (flujo)\n"
+        "  --candidatos=N --rondas=R        con --optimizar, candidatos por ronda (64) y rondas (20)\n"
+        "  --repartos                       con --optimizar, tambien mueve ticks entre verde y rojo\n"
+        "  --punto-control=ruta             con el motor clasico, guarda vehiculos, semaforos, tick y\n"
+        "                                   semilla (binario versionado, reemplazo atomico) sin frenar\n"
+        "                                   la simulacion: un hilo aparte escribe la copia\n"
+        "  --intervalo-control=K            ticks entre puntos de control (100)\n"
+        "  --reanudar=ruta                  sigue desde un punto de control (mapeado, sin copia); los\n"
+        "                                   argumentos posicionales deben coincidir con el archivo\n"
+        "  --escenario=ruta                 vehiculos y semaforos de un archivo: binario (mapeado, sin\n"
+        "                                   copia) o texto con lineas 'largo L', 'semaforo pos verde\n"
+        "                                   amarillo rojo desfase' y 'vehiculo pos vel'; los vehiculos,\n"
+        "                                   semaforos y largo posicionales se ignoran\n"
+        "  --exportar-escenario=ruta        escribe el estado inicial como escenario binario y termina\n"
+        "  --reordenar=K                    con soa/analitico, mide el desorden cada K ticks y\n"
+        "                                   reordena por posicion si hace falta (0: nunca)\n"
+        "  --salida=texto|binaria|ninguna   formato de la salida por tick (texto)\n"
+        "  --archivo=ruta                   destino de la salida binaria (trayectoria.tray)\n"
+        "  --cada=K                         emite solo cada K ticks y el ultimo (1)\n"
+        "  --cola=N                         escribe en un hilo aparte con un anillo de N frames (0)\n"
+        "  --politica=bloquear|descartar    con el anillo lleno (bloquear)\n"
+        "  --reporte=ruta.json              tiempos por fase y tick en JSON\n"
+        "  --isa=auto|base|sse4.2|avx2|avx512\n"
+        "                                   variante de los kernels de movimiento y semaforos; auto\n"
+        "                                   elige la mejor que soporte la CPU (por defecto), base es la\n"
+        "                                   del build sin extensiones; tambien vale con --benchmark\n"
+        "  --numa                           hilos fijos a lugares (OMP_PLACES=cores, OMP_PROC_BIND=spread\n"
+        "                                   si no estan definidos), primer toque por tramo y topologia\n"
+        "Benchmark (sin argumentos posicionales, salida desactivada, CSV):\n"
+        "  %s --benchmark [--motor=persistente] [--hilos=1,2,4,8] [--vehiculos=100000]\n"
+        "     [--semaforos=1000] [--largos=1000000] [--iteraciones=100] [--reps=5]\n"
+        "     [--calentamiento=1] [--ciclo=9] [--seed=42] [--debil] [--csv=ruta]\n"
+        "  --debil escala vehiculos, semaforos y largo por el numero de hilos.\n",
+        prog, prog, prog
     );
 }
 
 int main(int argc, char **argv) {
-    if (argc < 5) {
+    const char *isa = opcion(argc, argv, "isa");
+    if (trafico_elegir_isa(isa) != 0) {
+        fprintf(stderr, "--isa=%s no existe o esta CPU no la soporta (auto|base|sse4.2|avx2|avx512)\n", isa);
+        return 1;
+    }
+    if (opcion(argc, argv, "benchmark")) return benchmark(argc, argv);
+    int numa = (opcion(argc, argv, "numa") != NULL);
+    if (numa) {
+        preparar_numa(argv);
+        omp_set_dynamic(0);
+    }
+
+    // Argumentos posicionales (los que no empiezan con "--")
+    char *arg[9] = { argv[0] };
+    int n_arg = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0) continue;
+        if (n_arg < 9) arg[n_arg++] = argv[i];
+    }
+    if (n_arg < 5) {
         uso(argv[0]);
         return 1;
     }
-    int n_veh  = atoi(argv[1]);
-    int n_sem  = atoi(argv[2]);
-    int iters  = atoi(argv[3]);
-    int road   = atoi(argv[4]);
-    int delay  = (argc > 5) ? atoi(argv[5]) : 0;
-    int ciclo  = (argc > 6) ? atoi(argv[6]) : 9; // verde 50%, amarillo 20%, rojo resto
-    int usar_secciones = (argc > 7) ? atoi(argv[7]) : 1;
-    unsigned int seed  = (argc > 8) ? (unsigned int)strtoul(argv[8], NULL, 10) : (unsigned int)time(NULL);
+    long long n_veh_64 = atoll(arg[1]);
+    int n_sem  = atoi(arg[2]);
+    int iters  = atoi(arg[3]);
+    long long road_64  = atoll(arg[4]);
+    int delay  = (n_arg > 5) ? atoi(arg[5]) : 0;
+    int ciclo  = (n_arg > 6) ? atoi(arg[6]) : 9; // verde 50%, amarillo 20%, rojo resto
+    int usar_secciones = (n_arg > 7) ? atoi(arg[7]) : 1;
+    unsigned int seed  = (n_arg > 8) ? (unsigned int)strtoul(arg[8], NULL, 10) : (unsigned int)time(NULL);
+
+    // Con --escenario los vehículos, semáforos y largo salen del archivo (los
+    // posicionales se ignoran) y los motores usan sus arreglos sin copiar
+    const char *ruta_escenario = opcion(argc, argv, "escenario");
+    Escenario esc;
+    memset(&esc, 0, sizeof(esc));
+    if (ruta_escenario) {
+        if (trafico_cargar_escenario(&esc, ruta_escenario) != 0) {
+            fprintf(stderr, "No se pudo cargar el escenario %s\n", ruta_escenario);
+            return 1;
+        }
+        n_veh_64 = esc.n_veh;
+        n_sem = esc.n_sem;
+        road_64 = esc.largo;
+    }
 
-    if (n_veh <= 0 || n_sem <= 0 || iters <= 0 || road <= 2) {
+    const char *motor = opcion(argc, argv, "motor");
+    if (!motor) motor = "clasico";
+    // Fuera del rango de int sólo corre el motor compacto con índices de 64 bits
+    int indices_64 = requiere_indices_64(n_veh_64, road_64);
+    if (indices_64 && strcmp(motor, "compacto") != 0) {
+        fprintf(stderr, "Escenario de 64 bits: se usa el motor compacto\n");
+        motor = "compacto";
+    }
+    int n_veh = indices_64 ? 0 : (int)n_veh_64;
+    int road  = indices_64 ? 0 : (int)road_64;
+    int dinamico = (strcmp(motor, "clasico") == 0 && !numa);
+    // Sólo los motores sobre Vehiculo[] tienen variante con secciones
+    int con_secciones = strcmp(motor, "clasico") == 0 || strcmp(motor, "persistente") == 0;
+
+    Salida out;
+    const char *salida = opcion(argc, argv, "salida");
+    int salida_dada = (salida != NULL);
+    if (!salida) salida = "texto";
+    out.tipo = SALIDA_TEXTO;
+    if (strcmp(salida, "binaria") == 0) out.tipo = SALIDA_BINARIA;
+    if (strcmp(salida, "ninguna") == 0) out.tipo = SALIDA_NINGUNA;
+    int salida_valida = (out.tipo != SALIDA_TEXTO || strcmp(salida, "texto") == 0);
+    const char *cola = opcion(argc, argv, "cola");
+    const char *politica = opcion(argc, argv, "politica");
+    int descartar = (politica && strcmp(politica, "descartar") == 0);
+    if (politica && !descartar && strcmp(politica, "bloquear") != 0) salida_valida = 0;
+
+    if (n_veh_64 <= 0 || n_sem <= 0 || iters <= 0 || road_64 <= 2 || !salida_valida ||
+        !motor_valido(motor)) {
         uso(argv[0]);
         return 1;
     }
+    if (indices_64 && out.tipo != SALIDA_NINGUNA) {
+        fprintf(stderr, "La salida por tick no admite escenarios de 64 bits: use --salida=ninguna\n");
+        return 1;
+    }
+    const char *lista_semillas = opcion(argc, argv, "semillas");
+    unsigned int *semillas = NULL;
+    int n_semillas = 0;
+    if (lista_semillas) {
+        if (opcion(argc, argv, "motor") && strcmp(motor, "analitico") != 0) {
+            fprintf(stderr, "--semillas usa el nucleo analitico: omita --motor o use --motor=analitico\n");
+            return 1;
+        }
+        // El conjunto no tiene salida por tick: sólo la tabla por semilla
+        if (salida_dada || cola || opcion(argc, argv, "cada") || opcion(argc, argv, "archivo")) {
+            fprintf(stderr, "--semillas no tiene salida por tick: omita --salida, --archivo, --cada y --cola\n");
+            return 1;
+        }
+        n_semillas = leer_semillas(lista_semillas, &semillas);
+        if (n_semillas == 0 || indices_64) {
+            fprintf(stderr, "--semillas=a-b|a,b,c invalido (o escenario de 64 bits)\n");
+            return 1;
+        }
+        motor = "analitico";
+        dinamico = con_secciones = 0;
+    }
+    const char *optimizar = opcion(argc, argv, "optimizar");
+    const char *objetivo = opcion(argc, argv, "objetivo");
+    int paradas = (objetivo && strcmp(objetivo, "paradas") == 0);
+    const char *cand = opcion(argc, argv, "candidatos");
+    const char *rond = opcion(argc, argv, "rondas");
+    int candidatos = cand ? atoi(cand) : 64;
+    int rondas = rond ? atoi(rond) : 20;
+    if (optimizar && ((opcion(argc, argv, "motor") && strcmp(motor, "analitico") != 0) || lista_semillas || indices_64 ||
+                      (objetivo && !paradas && strcmp(objetivo, "flujo") != 0) || candidatos < 2 || rondas < 0)) {
+        fprintf(stderr, "--optimizar usa el nucleo analitico, sin --semillas, con --objetivo=flujo|paradas,\n"
+                        "--candidatos >= 2 y --rondas >= 0\n");
+        return 1;
+    }
+    // El optimizador sólo escribe el plan: no hay salida por tick ni fases que reportar
+    if (optimizar && (salida_dada || cola || politica || opcion(argc, argv, "cada") || opcion(argc, argv, "archivo") ||
+                      opcion(argc, argv, "reporte"))) {
+        fprintf(stderr, "--optimizar solo escribe el plan: omita --salida, --archivo, --cada, --cola, --politica y --reporte\n");
+        return 1;
+    }
+    if (optimizar) {
+        motor = "analitico";
+        dinamico = con_secciones = 0;
+    }
+    // Puntos de control y reanudación (sólo trafico_simular_dinamico). Al reanudar, los
+    // vehículos y semáforos se usan directo desde el archivo mapeado.
+    const char *control = opcion(argc, argv, "punto-control");
+    const char *intervalo = opcion(argc, argv, "intervalo-control");
+    const char *reanudar = opcion(argc, argv, "reanudar");
+    int cada_control = intervalo ? atoi(intervalo) : 100;
+    if ((control || reanudar) && (strcmp(motor, "clasico") != 0 || cada_control <= 0)) {
+        fprintf(stderr, "--punto-control y --reanudar son del motor clasico, con --intervalo-control >= 1\n");
+        return 1;
+    }
+    ArchivoMapeado mapa;
+    memset(&mapa, 0, sizeof(mapa));
+    const CabeceraEstado *cab = NULL;
+    if (reanudar) {
+        if (trafico_mapear_archivo(&mapa, reanudar) != 0 || !(cab = trafico_validar_archivo_estado(&mapa, ESTADO_MAGIC_CONTROL))) {
+            fprintf(stderr, "%s no es un punto de control valido\n", reanudar);
+            return 1;
+        }
+        if ((int)cab->n_veh != n_veh || (int)cab->n_sem != n_sem || (int)cab->largo != road) {
+            fprintf(stderr, "El punto de control es de %u vehiculos, %u semaforos y largo %u\n",
+                    cab->n_veh, cab->n_sem, cab->largo);
+            return 1;
+        }
+        seed = cab->semilla;
+    }
+    const char *exportar = opcion(argc, argv, "exportar-escenario");
+    if ((ruta_escenario || exportar) && (strcmp(motor, "compacto") == 0 || strcmp(motor, "red") == 0 || lista_semillas)) {
+        fprintf(stderr, "--escenario y --exportar-escenario no aplican a compacto, red ni --semillas\n");
+        return 1;
+    }
+    if (ruta_escenario && reanudar) {
+        fprintf(stderr, "--reanudar ya trae su estado: no se combina con --escenario\n");
+        return 1;
+    }
+    const char *carr = opcion(argc, argv, "carriles");
+    int carriles = carr ? atoi(carr) : 1;
+    if (carriles < 1 || (carriles > 1 && strcmp(motor, "exclusion") != 0) ||
+        (carriles > 1 && (long long)carriles * road_64 > LIMITE_INDICE_32)) {
+        fprintf(stderr, "--carriles=K requiere --motor=exclusion, K >= 1 y K * largo < 2^31\n");
+        return 1;
+    }
+    if (ruta_escenario && carriles > 1) {
+        fprintf(stderr, "--carriles reparte sus propios vehiculos entre carriles: no se combina con --escenario\n");
+        return 1;
+    }
+    if (strcmp(motor, "exclusion") == 0 && n_veh > (long long)road * carriles) {
+        fprintf(stderr, "Con exclusion no caben %d vehiculos en %lld celdas\n", n_veh, (long long)road * carriles);
+        return 1;
+    }
+    // La red tiene un semáforo por calle y la salida numera sus celdas seguidas
+    // (y con carriles, las de cada carril)
+    int red = (strcmp(motor, "red") == 0);
+    int red_filas = 8, red_cols = 8;
+    const char *grilla = opcion(argc, argv, "red");
+    if (grilla && (sscanf(grilla, "%dx%d", &red_filas, &red_cols) != 2 || red_filas < 1 || red_cols < 1)) {
+        red_filas = 0;
+    }
+    if ((grilla && !red) || (red && (red_filas < 1 || 4LL * red_filas * red_cols * road_64 > LIMITE_INDICE_32))) {
+        fprintf(stderr, "--red=FxC requiere --motor=red, F y C >= 1 y 4 * F * C * largo < 2^31\n");
+        return 1;
+    }
+    int largo_salida = red ? 4 * red_filas * red_cols * road : road * carriles;
+    out.n_veh = n_veh;
+    out.n_sem = red ? 4 * red_filas * red_cols : n_sem;
+    const char *cada = opcion(argc, argv, "cada");
+    out.cada = cada ? atoi(cada) : 1;
+    out.ultimo = iters - 1;
+    if (trafico_crear_cola_salida(&out, cola ? atoi(cola) : 0, descartar) != 0) {
+        fprintf(stderr, "Sin memoria para la cola de salida\n");
+        return 1;
+    }
+    if (out.tipo == SALIDA_BINARIA) {
+        const char *archivo = opcion(argc, argv, "archivo");
+        if (!archivo) archivo = "trayectoria.tray";
+        if (tray_abrir_escritura(&out.tray, archivo, n_veh, out.n_sem, largo_salida) != 0) {
+            fprintf(stderr, "No se pudo crear %s\n", archivo);
+            return 1;
+        }
+    }
 
-    Vehiculo *veh = (Vehiculo*)malloc(sizeof(Vehiculo) * n_veh);
-    Semaforo *sem = (Semaforo*)malloc(sizeof(Semaforo) * n_sem);
+    // Los motores compacto y red y el conjunto de semillas generan sus
+    // vehículos directo en su formato
+    int compacto = (strcmp(motor, "compacto") == 0);
+    Vehiculo *veh = (compacto || red || semillas) ? NULL
+                  : cab ? (Vehiculo*)(mapa.base + cab->off_vehiculos)
+                  : esc.veh ? esc.veh : (Vehiculo*)malloc(sizeof(Vehiculo) * n_veh);
+    Semaforo *sem = cab ? (Semaforo*)(mapa.base + cab->off_semaforos)
+                  : esc.sem ? esc.sem : (Semaforo*)malloc(sizeof(Semaforo) * n_sem);
+    int *celda_sem = (compacto || red) ? NULL : (int*)malloc(sizeof(int) * road);
+    int prestados = (cab || esc.sem);   // veh y sem son del archivo mapeado o del escenario
 
-    inicializar_vehiculos(veh, n_veh, road, seed);
-    inicializar_semaforos(sem, n_sem, road, ciclo);
+    if (prestados) {
+        trafico_construir_celda_sem(sem, n_sem, road, celda_sem);
+    } else {
+        if (veh) trafico_inicializar_vehiculos(veh, n_veh, road, seed);
+        trafico_inicializar_semaforos(sem, n_sem, road_64, ciclo, celda_sem);
+    }
+    if (esc.veh && strcmp(motor, "exclusion") == 0 && !trafico_posiciones_crecientes(veh, n_veh)) {
+        fprintf(stderr, "Con exclusion el escenario debe tener posiciones distintas y crecientes por vehiculo\n");
+        return 1;
+    }
+    if (exportar) {
+        int r = trafico_escribir_archivo_estado(exportar, ESTADO_MAGIC_ESCENARIO, veh, n_veh, sem, n_sem, road, 0, seed);
+        if (r == 0) printf("Escenario binario escrito en %s\n", exportar);
+        else fprintf(stderr, "No se pudo escribir el escenario %s\n", exportar);
+        if (!prestados) {
+            free(veh);
+            free(sem);
+        }
+        trafico_liberar_escenario(&esc);
+        free(celda_sem);
+        return (r == 0) ? 0 : 1;
+    }
+    PuntoControl pc;
+    if (trafico_crear_punto_control(&pc, control, control ? cada_control : 0, n_veh, n_sem, road, seed) != 0) {
+        fprintf(stderr, "Sin memoria para el punto de control\n");
+        return 1;
+    }
+    if (cab) pc.inicio = (cab->tick < (uint64_t)iters) ? (int)cab->tick : iters;
 
     printf("Simulacion de trafico con OpenMP\n");
-    printf("Vehiculos: %d | Semaforos: %d | Iteraciones: %d | Largo: %d | Hilos dinamicos ON\n",
-           n_veh, n_sem, iters, road);
+    printf("Vehiculos: %lld | Semaforos: %d | Iteraciones: %d | Largo: %lld | Hilos dinamicos %s\n",
+           n_veh_64, out.n_sem, iters, road_64, dinamico ? "ON" : "OFF");
     printf("Secciones paralelas: %s | Delay: %d s | Ciclo semaforo: %d ticks\n",
-           usar_secciones ? "Si" : "No", delay, ciclo);
+           (usar_secciones && con_secciones) ? "Si" : "No", delay, ciclo);
+    printf("Motor: %s%s | Kernels: %s\n", motor, indices_64 ? " (indices de 64 bits)" : semillas ? " (conjunto de semillas)" :
+                                 optimizar ? " (optimizador de semaforos)" : "", trafico_isa());
+    if (cab) printf("Reanudando en el tick %d desde %s\n", pc.inicio, reanudar);
+    if (ruta_escenario) printf("Escenario: %s (%s)\n", ruta_escenario, esc.mapa.base ? "binario mapeado" : "texto");
+    if (control) printf("Punto de control: %s cada %d ticks\n", control, cada_control);
+    if (red) printf("Red: %dx%d cruces | Calles: %d de %d celdas\n", red_filas, red_cols, out.n_sem, road);
+    if (numa) reportar_topologia();
 
-    double t0 = omp_get_wtime();
-    simular_dinamico(iters, veh, n_veh, sem, n_sem, road, delay, usar_secciones);
-    double t1 = omp_get_wtime();
-    printf("Tiempo de simulacion: %.6f segundos\n", t1 - t0);
-    free(veh);
-    free(sem);
+    const char *reporte = opcion(argc, argv, "reporte");
+    Metricas met;
+    if (reporte && trafico_crear_metricas(&met, iters) != 0) {
+        fprintf(stderr, "Sin memoria para las metricas de %d iteraciones\n", iters);
+        return 1;
+    }
+    if (reporte) met.inicio = pc.inicio;
+
+    const char *frenado = opcion(argc, argv, "frenado");
+    const char *reordenar = opcion(argc, argv, "reordenar");
+    long long cambios_carril = 0;
+    Corrida corrida = { motor, iters, n_veh, n_sem, road, delay, usar_secciones, veh, sem, celda_sem,
+                        reporte ? &met : NULL, seed, frenado ? atof(frenado) : 0.0,
+                        reordenar ? atoi(reordenar) : 0, numa, carriles, red_filas, red_cols,
+                        (control || reanudar) ? &pc : NULL, &cambios_carril };
+    double t = indices_64 ? correr_compacto(n_veh_64, road_64, iters, sem, n_sem, seed, delay, &out, corrida.met)
+             : optimizar  ? correr_optimizador(iters, veh, n_veh, sem, n_sem, celda_sem, road,
+                                               candidatos, rondas, paradas, opcion(argc, argv, "repartos") != NULL, seed, optimizar)
+             : semillas   ? correr_conjunto(iters, n_veh, sem, n_sem, celda_sem, road, semillas, n_semillas,
+                                            opcion(argc, argv, "csv"), corrida.met)
+                          : correr_con_escritor(&corrida, &out);
+    if (t < 0) return 1;
+    printf("Tiempo de simulacion: %.6f segundos\n", t);
+    // Con la cola ya cerrada, para no mezclarse con los frames
+    if (carriles > 1) printf("Cambios de carril: %lld\n", cambios_carril);
+    if (reporte) {
+        long long actualizados = n_veh_64 * (semillas ? n_semillas : 1);
+        if (trafico_escribir_reporte(&met, reporte, motor, actualizados, out.n_sem, red ? largo_salida : road_64, t) != 0) {
+            fprintf(stderr, "No se pudo escribir el reporte %s\n", reporte);
+        }
+        trafico_liberar_metricas(&met);
+    }
+    if (out.cola.descartados > 0) {
+        printf("Frames descartados por cola llena: %lld\n", out.cola.descartados);
+    }
+    if (out.tipo == SALIDA_BINARIA && tray_cerrar(&out.tray) != 0) {
+        fprintf(stderr, "Error al cerrar la trayectoria\n");
+    }
+    trafico_liberar_cola_salida(&out);
+    if (pc.error) fprintf(stderr, "Hubo errores al escribir puntos de control\n");
+    trafico_liberar_punto_control(&pc);
+    if (!prestados) {
+        free(veh);
+        free(sem);
+    }
+    trafico_desmapear_archivo(&mapa);
+    trafico_liberar_escenario(&esc);
+    free(celda_sem);
+    free(semillas);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,2916 @@
+// Motores de la simulación de tráfico y la API de trafico.h (al final).
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <omp.h>
+#include "trafico_interno.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+  #define SLEEP_SEC(x) Sleep((x) * 1000)
+  #define PAUSA_BREVE() Sleep(1)
+  #define RENOMBRAR(a, b) (MoveFileExA(a, b, MOVEFILE_REPLACE_EXISTING) ? 0 : -1)
+#else
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #define SLEEP_SEC(x) sleep(x)
+  #define PAUSA_BREVE() usleep(100)
+  #define RENOMBRAR(a, b) rename(a, b)
+#endif
+
+// -------------------- Utilidades --------------------
+static inline int mod_pos(int x, int m) {
+    int r = x % m;
+    return (r < 0) ? r + m : r;
+}
+
+// Variante sin división de mod_pos, válida para 0 <= x < 2*m (pos + vel_max
+// con vel_max <= m). Sin ramas para que el compilador pueda vectorizarla.
+static inline int mod_pos_paso(int x, int m) {
+    return x - ((x >= m) ? m : 0);
+}
+
+static void* alloc_alineado(size_t bytes) {
+#if defined(_WIN32) || defined(_WIN64)
+    return _aligned_malloc(bytes, ALINEACION_BYTES);
+#else
+    void *p = NULL;
+    if (posix_memalign(&p, ALINEACION_BYTES, bytes) != 0) return NULL;
+    return p;
+#endif
+}
+
+static void liberar_alineado(void *p) {
+#if defined(_WIN32) || defined(_WIN64)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// -------------------- Despacho por ISA --------------------
+// Los kernels de movimiento y de semáforos se compilan una vez por nivel de
+// ISA y al arrancar se elige el mejor que soporte la CPU (CPUID vía
+// __builtin_cpu_supports): un binario compilado para x86-64 base usa AVX2 o
+// AVX-512 donde los haya. "base" es el kernel tal como lo compilan las
+// opciones del build (escalar salvo lo que den ellas, SSE2 en x86-64) y es
+// el único fuera de GCC/Clang sobre x86.
+// Cada familia de kernels define sus variantes con ISA_VARIANTES y arma con
+// ISA_TABLA un arreglo de punteros indexado por isa_activa.
+typedef enum {
+    ISA_BASE = 0,
+    ISA_SSE42,
+    ISA_AVX2,
+    ISA_AVX512,
+    N_ISA
+} NivelIsa;
+
+static const char *NOMBRE_ISA[N_ISA] = { "base", "sse4.2", "avx2", "avx512" };
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define ISA_DESPACHO 1
+  #define ISA_VARIANTES(DEFINIR) \
+      DEFINIR(base, ) \
+      DEFINIR(sse42, __attribute__((target("sse4.2")))) \
+      DEFINIR(avx2, __attribute__((target("avx2")))) \
+      DEFINIR(avx512, __attribute__((target("avx512f,avx512bw,avx512vl"))))
+  #define ISA_TABLA(k) { k##_base, k##_sse42, k##_avx2, k##_avx512 }
+#else
+  #define ISA_DESPACHO 0
+  #define ISA_VARIANTES(DEFINIR) DEFINIR(base, )
+  #define ISA_TABLA(k) { k##_base, k##_base, k##_base, k##_base }
+#endif
+
+// Se lee en cada llamada a un kernel: sólo cambia en trafico_elegir_isa,
+// fuera de las regiones paralelas
+static NivelIsa isa_activa = ISA_BASE;
+static int isa_elegida = 0;
+
+static int isa_soportada(NivelIsa n) {
+#if ISA_DESPACHO
+    __builtin_cpu_init();
+    switch (n) {
+        case ISA_SSE42:  return __builtin_cpu_supports("sse4.2");
+        case ISA_AVX2:   return __builtin_cpu_supports("avx2");
+        case ISA_AVX512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                                __builtin_cpu_supports("avx512vl");
+        default:         return 1;
+    }
+#else
+    return n == ISA_BASE;
+#endif
+}
+
+int trafico_elegir_isa(const char *nombre) {
+    if (!nombre || strcmp(nombre, "auto") == 0) {
+        int n = N_ISA - 1;
+        while (n > ISA_BASE && !isa_soportada((NivelIsa)n)) n--;
+        isa_activa = (NivelIsa)n;
+        isa_elegida = 1;
+        return 0;
+    }
+    for (int n = 0; n < N_ISA; n++) {
+        if (strcmp(nombre, NOMBRE_ISA[n]) != 0) continue;
+        if (!isa_soportada((NivelIsa)n)) return -1;
+        isa_activa = (NivelIsa)n;
+        isa_elegida = 1;
+        return 0;
+    }
+    return -1;
+}
+
+const char *trafico_isa(void) {
+    return NOMBRE_ISA[isa_activa];
+}
+
+static inline const char* estado_to_str(EstadoSemaforo e) {
+    switch (e) {
+        case ROJO:     return "0";
+        case VERDE:    return "1";
+        case AMARILLO: return "2";
+        default:       return "?";
+    }
+}
+// -------------------- Generador basado en contador --------------------
+// Philox2x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// La salida es función pura de (contador, clave): no hay estado compartido, así
+// que cada hilo genera los números de "su" vehículo sin carreras ni locks y el
+// resultado no depende del número de hilos.
+static inline void philox2x32(uint32_t c0, uint32_t c1, uint32_t clave, uint32_t out[2]) {
+    for (int r = 0; r < 10; r++) {
+        uint64_t prod = (uint64_t)0xD256D193u * c0;
+        uint32_t hi = (uint32_t)(prod >> 32);
+        uint32_t lo = (uint32_t)prod;
+        c0 = hi ^ clave ^ c1;
+        c1 = lo;
+        clave += 0x9E3779B9u;
+    }
+    out[0] = c0;
+    out[1] = c1;
+}
+// -------------------- Inicialización --------------------
+// Vehículo i con espacio = largo / n (o 1): contador = (i, 0), clave = semilla
+static inline void vehiculo_inicial(int i, int espacio, int road_len, unsigned int seed, int *pos, int *vel_max) {
+    uint32_t r[2];
+    philox2x32((uint32_t)i, 0u, seed, r);
+    int jitter = (espacio > 1) ? (int)(r[0] % (uint32_t)espacio) : 0;
+    *pos = mod_pos(i * espacio + jitter, road_len);
+    *vel_max = 1 + (int)(r[1] & 1u); // 1 o 2
+}
+
+void trafico_inicializar_vehiculos(Vehiculo *v, int n, int road_len, unsigned int seed) {
+    // Distribuir vehículos de forma pseudoaleatoria no superpuesta y velocidad 1–2.
+    // Para evitar muchas colisiones iniciales, ubicamos espaciados con jitter
+    int espacio = (road_len > n) ? (road_len / n) : 1;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        v[i].id = i;
+        vehiculo_inicial(i, espacio, road_len, seed, &v[i].pos, &v[i].vel_max);
+    }
+}
+
+// Semáforo i de n, espaciados a lo largo de la carretera. Si hay más
+// semáforos que celdas (espacio 1) el primero de cada celda es el de índice < largo.
+static inline long long posicion_semaforo(long long i, long long n, long long road_len) {
+    long long espacio = (road_len > n) ? (road_len / n) : 1;
+    return i * espacio % road_len;
+}
+
+// Tabla celda -> índice de semáforo (-1 si la celda no tiene semáforo).
+// Si varios semáforos caen en la misma celda gana el de menor índice,
+// igual que el primer match del recorrido lineal original.
+void trafico_construir_celda_sem(const Semaforo *s, int n, int road_len, int *celda_sem) {
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < road_len; c++) {
+        celda_sem[c] = -1;
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        celda_sem[s[i].pos] = i;
+    }
+}
+
+// Con un largo de 64 bits pos queda en -1: sólo el motor compacto admite esos
+// largos y toma las posiciones de posicion_semaforo.
+void trafico_inicializar_semaforos(Semaforo *s, int n, long long road_len, int ciclo_total, int *celda_sem) {
+    // Colocar semáforos espaciados a lo largo de la carretera.
+    // Ajuste de ciclo: verde > amarillo > rojo
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        long long p = posicion_semaforo(i, n, road_len);
+        s[i].id = i;
+        s[i].pos = (p <= INT_MAX) ? (int)p : -1;
+        s[i].estado = (i % 2 == 0) ? VERDE : ROJO; // alternar para variedad
+        s[i].t_en_estado = 0;
+
+        // Duraciones proporcionales al ciclo total
+        s[i].dur_verde    = (int)(ciclo_total * 0.5); // 50%
+        s[i].dur_amarillo = (int)(ciclo_total * 0.2); // 20%
+        s[i].dur_rojo     = ciclo_total - s[i].dur_verde - s[i].dur_amarillo;
+        if (s[i].dur_verde < 1) s[i].dur_verde = 1;
+        if (s[i].dur_amarillo < 1) s[i].dur_amarillo = 1;
+        if (s[i].dur_rojo < 1) s[i].dur_rojo = 1;
+    }
+
+    // El motor compacto no usa la tabla celda -> semáforo y pasa NULL
+    if (celda_sem) trafico_construir_celda_sem(s, n, (int)road_len, celda_sem);
+}
+
+// -------------------- Semáforos --------------------
+static int crear_estado_semaforos(EstadoSemaforos *e, const Semaforo *s, int n) {
+    e->buf[0] = (unsigned char*)malloc(n);
+    e->buf[1] = (unsigned char*)malloc(n);
+    e->act = 0;
+    if (!e->buf[0] || !e->buf[1]) {
+        free(e->buf[0]);
+        free(e->buf[1]);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        e->buf[0][i] = e->buf[1][i] = (unsigned char)s[i].estado;
+    }
+    return 0;
+}
+
+static void liberar_estado_semaforos(EstadoSemaforos *e) {
+    free(e->buf[0]);
+    free(e->buf[1]);
+    e->buf[0] = e->buf[1] = NULL;
+}
+
+static inline unsigned char* estado_actual(EstadoSemaforos *e)    { return e->buf[e->act]; }
+static inline unsigned char* estado_siguiente(EstadoSemaforos *e) { return e->buf[1 - e->act]; }
+static inline void intercambiar_estado(EstadoSemaforos *e)        { e->act = 1 - e->act; }
+
+static inline EstadoSemaforo siguiente_estado(const Semaforo *s) {
+    switch (s->estado) {
+        case VERDE:    return AMARILLO;
+        case AMARILLO: return ROJO;
+        case ROJO:     return VERDE;
+        default:       return ROJO;
+    }
+}
+
+// Un tick de un semáforo
+static inline void avanzar_semaforo(Semaforo *s) {
+    s->t_en_estado++;
+    int limite = 0;
+    switch (s->estado) {
+        case VERDE:    limite = s->dur_verde;    break;
+        case AMARILLO: limite = s->dur_amarillo; break;
+        case ROJO:     limite = s->dur_rojo;     break;
+        default:       limite = 1;               break;
+    }
+    if (s->t_en_estado >= limite) {
+        s->estado = siguiente_estado(s);
+        s->t_en_estado = 0;
+    }
+}
+
+// Worksharing huérfano: reparte los semáforos entre el equipo que lo llama
+// (o los procesa todos fuera de una región paralela). Sin barrera final:
+// quien llama decide dónde sincronizar.
+// El nuevo estado se publica en estado_pub (puede ser NULL si nadie lo lee).
+#define DEFINIR_ACTUALIZAR_SEMAFOROS(isa, ATRIB) \
+ATRIB static void actualizar_semaforos_for_##isa(Semaforo *s, int n, unsigned char *estado_pub) { \
+    _Pragma("omp for schedule(static) nowait") \
+    for (int i = 0; i < n; i++) { \
+        avanzar_semaforo(&s[i]); \
+        if (estado_pub) estado_pub[i] = (unsigned char)s[i].estado; \
+    } \
+}
+ISA_VARIANTES(DEFINIR_ACTUALIZAR_SEMAFOROS)
+
+static void (*const ACTUALIZAR_SEMAFOROS_FOR[N_ISA])(Semaforo*, int, unsigned char*) =
+    ISA_TABLA(actualizar_semaforos_for);
+
+static void actualizar_semaforos_for(Semaforo *s, int n, unsigned char *estado_pub) {
+    ACTUALIZAR_SEMAFOROS_FOR[isa_activa](s, n, estado_pub);
+}
+
+static void actualizar_semaforos(Semaforo *s, int n, unsigned char *estado_pub) {
+    // Paralelizar por semáforo
+    #pragma omp parallel
+    actualizar_semaforos_for(s, n, estado_pub);
+}
+// -------------------- Estado analítico de semáforos --------------------
+// Cada semáforo recorre VERDE -> AMARILLO -> ROJO con duraciones fijas, así que
+// tras k llamadas a actualizar_semaforos su estado sólo depende de su fase
+// inicial y de k: fase(k) = (fase0 + k) mod ciclo. Cada configuración distinta
+// de duraciones tiene una tabla estado[fase]; los semáforos sólo guardan qué
+// ciclo usan y su fase al tick 0.
+typedef struct {
+    int dur_verde;
+    int dur_amarillo;
+    int dur_rojo;
+    int largo;                  // dur_verde + dur_amarillo + dur_rojo
+    unsigned char *estado;      // estado[f], f en [0, largo)
+} CicloSemaforo;
+
+typedef struct {
+    int ciclo;      // índice en TablaCiclos.ciclos
+    int fase0;      // fase en el ciclo con 0 actualizaciones aplicadas
+} FaseSemaforo;
+
+typedef struct {
+    CicloSemaforo *ciclos;
+    int n_ciclos;
+    FaseSemaforo *fase;
+    int n_sem;
+} TablaCiclos;
+
+// Fase del ciclo correspondiente a (estado, t_en_estado)
+static inline int fase_de_semaforo(const Semaforo *s) {
+    switch (s->estado) {
+        case VERDE:    return s->t_en_estado;
+        case AMARILLO: return s->dur_verde + s->t_en_estado;
+        default:       return s->dur_verde + s->dur_amarillo + s->t_en_estado;
+    }
+}
+
+// Pone el semáforo en la fase f de su ciclo (inversa de fase_de_semaforo)
+static inline void poner_fase_semaforo(Semaforo *s, int f) {
+    if (f < s->dur_verde) {
+        s->estado = VERDE;
+        s->t_en_estado = f;
+    } else if (f < s->dur_verde + s->dur_amarillo) {
+        s->estado = AMARILLO;
+        s->t_en_estado = f - s->dur_verde;
+    } else {
+        s->estado = ROJO;
+        s->t_en_estado = f - s->dur_verde - s->dur_amarillo;
+    }
+}
+
+typedef struct {
+    int dur[3];
+    int j;
+} ClaveCiclo;
+
+static int comparar_clave_ciclo(const void *a, const void *b) {
+    const ClaveCiclo *x = (const ClaveCiclo*)a, *y = (const ClaveCiclo*)b;
+    for (int k = 0; k < 3; k++) {
+        if (x->dur[k] != y->dur[k]) return (x->dur[k] > y->dur[k]) - (x->dur[k] < y->dur[k]);
+    }
+    return (x->j > y->j) - (x->j < y->j);
+}
+
+// Agrupa los semáforos por duraciones (orden + barrido) y arma una tabla por grupo
+static int crear_tabla_ciclos(TablaCiclos *t, const Semaforo *s, int n_sem) {
+    memset(t, 0, sizeof(*t));
+    ClaveCiclo *claves = (ClaveCiclo*)malloc(sizeof(ClaveCiclo) * n_sem);
+    t->fase = (FaseSemaforo*)malloc(sizeof(FaseSemaforo) * n_sem);
+    t->ciclos = (CicloSemaforo*)calloc(n_sem, sizeof(CicloSemaforo));
+    if (!claves || !t->fase || !t->ciclos) {
+        free(claves);
+        free(t->fase);
+        free(t->ciclos);
+        return -1;
+    }
+    t->n_sem = n_sem;
+    for (int j = 0; j < n_sem; j++) {
+        claves[j].dur[0] = s[j].dur_verde;
+        claves[j].dur[1] = s[j].dur_amarillo;
+        claves[j].dur[2] = s[j].dur_rojo;
+        claves[j].j = j;
+    }
+    qsort(claves, n_sem, sizeof(ClaveCiclo), comparar_clave_ciclo);
+
+    for (int k = 0; k < n_sem; k++) {
+        if (k == 0 || memcmp(claves[k].dur, claves[k - 1].dur, sizeof(claves[k].dur)) != 0) {
+            CicloSemaforo *c = &t->ciclos[t->n_ciclos++];
+            c->dur_verde = claves[k].dur[0];
+            c->dur_amarillo = claves[k].dur[1];
+            c->dur_rojo = claves[k].dur[2];
+            c->largo = c->dur_verde + c->dur_amarillo + c->dur_rojo;
+            c->estado = (unsigned char*)malloc(c->largo);
+            if (!c->estado) {
+                free(claves);
+                return -1;
+            }
+            for (int f = 0; f < c->largo; f++) {
+                c->estado[f] = (f < c->dur_verde) ? VERDE
+                             : (f < c->dur_verde + c->dur_amarillo) ? AMARILLO : ROJO;
+            }
+        }
+        int j = claves[k].j;
+        const CicloSemaforo *c = &t->ciclos[t->n_ciclos - 1];
+        t->fase[j].ciclo = t->n_ciclos - 1;
+        t->fase[j].fase0 = mod_pos(fase_de_semaforo(&s[j]), c->largo);
+    }
+    free(claves);
+    return 0;
+}
+
+static void liberar_tabla_ciclos(TablaCiclos *t) {
+    for (int c = 0; c < t->n_ciclos; c++) free(t->ciclos[c].estado);
+    free(t->ciclos);
+    free(t->fase);
+    memset(t, 0, sizeof(*t));
+}
+
+// Estado del semáforo j tras k actualizaciones (k >= 0), sin tocar estado compartido
+static inline unsigned char estado_en_tick(const TablaCiclos *t, int j, long long k) {
+    const CicloSemaforo *c = &t->ciclos[t->fase[j].ciclo];
+    return c->estado[(t->fase[j].fase0 + (int)(k % c->largo)) % c->largo];
+}
+
+// k mod largo de cada ciclo: con esto la fase de un semáforo en el tick k
+// sale con una suma y una resta condicional, sin divisiones por vehículo
+static void desplazamientos_en_tick(const TablaCiclos *t, long long k, int *desp) {
+    for (int c = 0; c < t->n_ciclos; c++) {
+        desp[c] = (int)(k % t->ciclos[c].largo);
+    }
+}
+
+// Estados de todos los semáforos tras k actualizaciones (para la salida)
+#define DEFINIR_ESTADOS_EN_TICK(isa, ATRIB) \
+ATRIB static void estados_en_tick_##isa(const TablaCiclos *t, long long k, unsigned char *estado) { \
+    _Pragma("omp parallel for schedule(static)") \
+    for (int j = 0; j < t->n_sem; j++) { \
+        estado[j] = estado_en_tick(t, j, k); \
+    } \
+}
+ISA_VARIANTES(DEFINIR_ESTADOS_EN_TICK)
+
+static void (*const ESTADOS_EN_TICK[N_ISA])(const TablaCiclos*, long long, unsigned char*) =
+    ISA_TABLA(estados_en_tick);
+
+static void estados_en_tick(const TablaCiclos *t, long long k, unsigned char *estado) {
+    ESTADOS_EN_TICK[isa_activa](t, k, estado);
+}
+
+// Deja Semaforo[] como lo habría dejado aplicar k veces actualizar_semaforos
+static void sincronizar_semaforos(const TablaCiclos *t, Semaforo *s, long long k) {
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < t->n_sem; j++) {
+        const CicloSemaforo *c = &t->ciclos[t->fase[j].ciclo];
+        poner_fase_semaforo(&s[j], (t->fase[j].fase0 + (int)(k % c->largo)) % c->largo);
+    }
+}
+// -------------------- Vehículos (lógica de movimiento) --------------------
+// Regla simple: un vehículo avanza hasta su vel_max salvo que el siguiente semáforo
+// por delante esté en ROJO o AMARILLO exactamente en su posición destino (o antes).
+// Para robustez un "stop range" = 0 (la celda del semáforo).
+// Btw leemos el estado publicado (doble buffer) para no leer mientras se actualizan.
+// El semáforo del destino se obtiene en O(1) con la tabla celda_sem.
+// Si hay semáforo justo en la celda de destino y no está VERDE, se detiene
+// (si no puede, se queda en su lugar).
+#define DEFINIR_MOVER_VEHICULOS(isa, ATRIB) \
+ATRIB static void mover_vehiculos_for_##isa(Vehiculo *v, int n_veh, const unsigned char *estado_sem, \
+                                            const int *celda_sem, int road_len) { \
+    _Pragma("omp for schedule(static) nowait") \
+    for (int i = 0; i < n_veh; i++) { \
+        int destino = mod_pos(v[i].pos + v[i].vel_max, road_len); \
+        int j = celda_sem[destino]; \
+        if (j >= 0 && (estado_sem[j] == ROJO || estado_sem[j] == AMARILLO)) continue; \
+        v[i].pos = destino; \
+    } \
+}
+ISA_VARIANTES(DEFINIR_MOVER_VEHICULOS)
+
+static void (*const MOVER_VEHICULOS_FOR[N_ISA])(Vehiculo*, int, const unsigned char*, const int*, int) =
+    ISA_TABLA(mover_vehiculos_for);
+
+static void mover_vehiculos_for(Vehiculo *v, int n_veh, const unsigned char *estado_sem, const int *celda_sem, int road_len) {
+    MOVER_VEHICULOS_FOR[isa_activa](v, n_veh, estado_sem, celda_sem, road_len);
+}
+
+static void mover_vehiculos(Vehiculo *v, int n_veh, const unsigned char *estado_sem, const int *celda_sem, int road_len) {
+    #pragma omp parallel
+    mover_vehiculos_for(v, n_veh, estado_sem, celda_sem, road_len);
+}
+// -------------------- Vehículos en SoA (kernel vectorizado) --------------------
+// Mismo modelo que mover_vehiculos pero con posiciones y velocidades en arreglos
+// separados. n se rellena hasta múltiplo de VEH_SOA_BLOQUE; el relleno tiene
+// vel_max = 0, así que nunca se mueve y el kernel no necesita bucle de resto.
+int trafico_crear_vehiculos_soa(VehiculosSoA *v, int n) {
+    v->n = n;
+    v->n_pad = (n + VEH_SOA_BLOQUE - 1) / VEH_SOA_BLOQUE * VEH_SOA_BLOQUE;
+    v->pos = (int*)alloc_alineado(sizeof(int) * v->n_pad);
+    v->vel_max = (int*)alloc_alineado(sizeof(int) * v->n_pad);
+    v->id = (int*)alloc_alineado(sizeof(int) * v->n_pad);
+    if (!v->pos || !v->vel_max || !v->id) {
+        liberar_alineado(v->pos);
+        liberar_alineado(v->vel_max);
+        liberar_alineado(v->id);
+        return -1;
+    }
+    for (int i = n; i < v->n_pad; i++) {
+        v->pos[i] = 0;
+        v->vel_max[i] = 0;
+        v->id[i] = i;
+    }
+    return 0;
+}
+
+void trafico_liberar_vehiculos_soa(VehiculosSoA *v) {
+    liberar_alineado(v->pos);
+    liberar_alineado(v->vel_max);
+    liberar_alineado(v->id);
+    v->pos = v->vel_max = v->id = NULL;
+    v->n = v->n_pad = 0;
+}
+
+void trafico_vehiculos_a_soa(const Vehiculo *src, VehiculosSoA *v) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < v->n; i++) {
+        v->pos[i] = src[i].pos;
+        v->vel_max[i] = src[i].vel_max;
+        v->id[i] = src[i].id;
+    }
+}
+
+// -------------------- Orden por posición --------------------
+// trafico_inicializar_vehiculos deja los vehículos ordenados por posición, pero con
+// vel_max distintas y la vuelta al anillo el orden del arreglo se va separando
+// del orden en la carretera y las lecturas de estado_celda/celda_sem se dispersan.
+// Cada periodo ticks se cuentan los descensos pos[i+1] < pos[i] - DESORDEN_VENTANA:
+// los adelantamientos locales no dispersan los accesos y no cuentan, y uno se
+// admite (el punto de vuelta: ordenado salvo rotación). Si pasan de
+// n / DESORDEN_DIV se reordena con radix LSD paralelo y estable por pos,
+// arrastrando vel_max e id.
+#define RADIX_BITS      11
+#define RADIX_CUBETAS   (1 << RADIX_BITS)
+#define DESORDEN_VENTANA 4096   // celdas: 16 KB de estado_celda
+#define DESORDEN_DIV    64
+
+int trafico_crear_orden_vehiculos(OrdenVehiculos *o, const VehiculosSoA *v, int periodo) {
+    memset(o, 0, sizeof(*o));
+    o->periodo = periodo;
+    o->hilos = omp_get_max_threads();
+    o->pos = (int*)alloc_alineado(sizeof(int) * v->n_pad);
+    o->vel_max = (int*)alloc_alineado(sizeof(int) * v->n_pad);
+    o->id = (int*)alloc_alineado(sizeof(int) * v->n_pad);
+    o->pos_por_id = (int*)malloc(sizeof(int) * (v->n > 0 ? v->n : 1));
+    o->hist = (size_t*)malloc(sizeof(size_t) * RADIX_CUBETAS * o->hilos);
+    if (!o->pos || !o->vel_max || !o->id || !o->pos_por_id || !o->hist) {
+        liberar_alineado(o->pos);
+        liberar_alineado(o->vel_max);
+        liberar_alineado(o->id);
+        free(o->pos_por_id);
+        free(o->hist);
+        return -1;
+    }
+    // El relleno queda igual en los dos juegos de arreglos
+    for (int i = v->n; i < v->n_pad; i++) {
+        o->pos[i] = v->pos[i];
+        o->vel_max[i] = v->vel_max[i];
+        o->id[i] = v->id[i];
+    }
+    return 0;
+}
+
+void trafico_liberar_orden_vehiculos(OrdenVehiculos *o) {
+    liberar_alineado(o->pos);
+    liberar_alineado(o->vel_max);
+    liberar_alineado(o->id);
+    free(o->pos_por_id);
+    free(o->hist);
+    memset(o, 0, sizeof(*o));
+}
+
+// Descensos fuera del punto de vuelta (0 si está ordenado salvo rotación)
+static long long desorden_vehiculos(const VehiculosSoA *v) {
+    long long descensos = 0;
+    #pragma omp parallel for simd schedule(static) reduction(+:descensos)
+    for (int i = 0; i < v->n - 1; i++) {
+        descensos += (v->pos[i + 1] < v->pos[i] - DESORDEN_VENTANA);
+    }
+    return (descensos > 0) ? descensos - 1 : 0;
+}
+
+// Radix LSD por pos: cada hilo cuenta su tramo, un prefijo por (cubeta, hilo)
+// da a cada hilo su rango de destino y el reparto conserva el orden (estable).
+static void ordenar_por_posicion(VehiculosSoA *v, OrdenVehiculos *o, int road_len) {
+    int n = v->n;
+    int bits = 1;
+    while (bits < 31 && (1 << bits) < road_len) bits++;
+
+    for (int desp = 0; desp < bits; desp += RADIX_BITS) {
+        const int *pos = v->pos, *vel = v->vel_max, *id = v->id;
+        int *pos2 = o->pos, *vel2 = o->vel_max, *id2 = o->id;
+        #pragma omp parallel num_threads(o->hilos)
+        {
+            int h = omp_get_thread_num(), nh = omp_get_num_threads();
+            size_t *hist = o->hist + (size_t)h * RADIX_CUBETAS;
+            int ini = (int)((long long)n * h / nh), fin = (int)((long long)n * (h + 1) / nh);
+            memset(hist, 0, sizeof(size_t) * RADIX_CUBETAS);
+            for (int i = ini; i < fin; i++) hist[(pos[i] >> desp) & (RADIX_CUBETAS - 1)]++;
+            #pragma omp barrier
+            #pragma omp single
+            {
+                size_t acum = 0;
+                for (int d = 0; d < RADIX_CUBETAS; d++) {
+                    for (int t = 0; t < nh; t++) {
+                        size_t c = o->hist[(size_t)t * RADIX_CUBETAS + d];
+                        o->hist[(size_t)t * RADIX_CUBETAS + d] = acum;
+                        acum += c;
+                    }
+                }
+            }
+            for (int i = ini; i < fin; i++) {
+                size_t k = hist[(pos[i] >> desp) & (RADIX_CUBETAS - 1)]++;
+                pos2[k] = pos[i];
+                vel2[k] = vel[i];
+                id2[k] = id[i];
+            }
+        }
+        // El destino pasa a ser el arreglo activo
+        int *t;
+        t = v->pos; v->pos = o->pos; o->pos = t;
+        t = v->vel_max; v->vel_max = o->vel_max; o->vel_max = t;
+        t = v->id; v->id = o->id; o->id = t;
+    }
+    o->reordenado = 1;
+    o->reordenamientos++;
+}
+
+// Llamar al final del tick i: mide cada periodo ticks y reordena si hace falta
+static void mantener_orden(VehiculosSoA *v, OrdenVehiculos *o, int road_len, int tick) {
+    if (!o || o->periodo <= 0 || (tick + 1) % o->periodo != 0) return;
+    if (desorden_vehiculos(v) > v->n / DESORDEN_DIV) ordenar_por_posicion(v, o, road_len);
+}
+
+// Posiciones para la salida, que siempre va por id
+static const int *posiciones_por_id(const VehiculosSoA *v, OrdenVehiculos *o) {
+    if (!o || !o->reordenado) return v->pos;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < v->n; i++) {
+        o->pos_por_id[v->id[i]] = v->pos[i];
+    }
+    return o->pos_por_id;
+}
+
+// Estado del semáforo proyectado sobre cada celda (VERDE si no hay semáforo),
+// para que el kernel resuelva el bloqueo con una sola lectura por vehículo.
+// Sólo escribe el semáforo dueño de la celda (el de menor índice, ver celda_sem).
+static void publicar_estado_celdas(const Semaforo *s, const unsigned char *estado, int n_sem, const int *celda_sem, int *estado_celda) {
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < n_sem; j++) {
+        if (celda_sem[s[j].pos] == j) {
+            estado_celda[s[j].pos] = estado[j];
+        }
+    }
+}
+
+// Kernel sin ramas: destino, envoltura, consulta del semáforo y selección.
+#define DEFINIR_MOVER_SOA(isa, ATRIB) \
+ATRIB static void mover_soa_##isa(int *restrict pos, const int *restrict vel, int n_pad, \
+                                  const int *estado_celda, int road_len) { \
+    _Pragma("omp parallel for simd schedule(static) aligned(pos, vel : ALINEACION_BYTES)") \
+    for (int i = 0; i < n_pad; i++) { \
+        int destino = mod_pos_paso(pos[i] + vel[i], road_len); \
+        pos[i] = (estado_celda[destino] == VERDE) ? destino : pos[i]; \
+    } \
+}
+ISA_VARIANTES(DEFINIR_MOVER_SOA)
+
+static void (*const MOVER_SOA[N_ISA])(int*, const int*, int, const int*, int) = ISA_TABLA(mover_soa);
+
+static void mover_vehiculos_soa(VehiculosSoA *v, const int *estado_celda, int road_len) {
+    MOVER_SOA[isa_activa](v->pos, v->vel_max, v->n_pad, estado_celda, road_len);
+}
+// Paso de un vehículo consultando el semáforo del destino en forma cerrada para
+// el tick cuyos desplazamientos por ciclo da desp (ver desplazamientos_en_tick):
+// 1 si avanza a *destino, 0 si el semáforo del destino no está VERDE. Lo
+// comparten el motor analítico y el optimizador (puntuar_plan).
+static inline int paso_analitico(int pos, int vel, const TablaCiclos *t, const int *desp,
+                                 const int *celda_sem, int road_len, int *destino) {
+    *destino = mod_pos_paso(pos + vel, road_len);
+    int j = celda_sem[*destino];
+    if (j < 0) return 1;
+    const FaseSemaforo *fs = &t->fase[j];
+    const CicloSemaforo *c = &t->ciclos[fs->ciclo];
+    return c->estado[mod_pos_paso(fs->fase0 + desp[fs->ciclo], c->largo)] == VERDE;
+}
+
+// No lee ningún estado publicado, así que no necesita fase de semáforos ni snapshot.
+#define DEFINIR_MOVER_ANALITICO(isa, ATRIB) \
+ATRIB static void mover_analitico_##isa(int *restrict pos, const int *restrict vel, int n_pad, const TablaCiclos *t, \
+                                        const int *desp, const int *celda_sem, int road_len) { \
+    _Pragma("omp parallel for schedule(static)") \
+    for (int i = 0; i < n_pad; i++) { \
+        int destino; \
+        if (paso_analitico(pos[i], vel[i], t, desp, celda_sem, road_len, &destino)) pos[i] = destino; \
+    } \
+}
+ISA_VARIANTES(DEFINIR_MOVER_ANALITICO)
+
+static void (*const MOVER_ANALITICO[N_ISA])(int*, const int*, int, const TablaCiclos*, const int*, const int*, int) =
+    ISA_TABLA(mover_analitico);
+
+static void mover_vehiculos_analitico(VehiculosSoA *v, const TablaCiclos *t, const int *desp, const int *celda_sem, int road_len) {
+    MOVER_ANALITICO[isa_activa](v->pos, v->vel_max, v->n_pad, t, desp, celda_sem, road_len);
+}
+// -------------------- Bucle de simulación --------------------
+// Pasos (en ints) entre posiciones consecutivas de un arreglo Vehiculo[]
+#define PASO_VEHICULO (sizeof(Vehiculo) / sizeof(int))
+
+// pos se recorre con paso_pos ints entre vehículos (PASO_VEHICULO para
+// Vehiculo[], 1 para SoA); el id de vehículo/semáforo es su índice.
+static void imprimir_estado(const int *pos, size_t paso_pos, int n_veh, const unsigned char *estado, int n_sem, int iter) {
+    printf("\nIteracion %d\n", iter + 1);
+    for (int i = 0; i < n_veh; i++) {
+        printf("Vehiculo %2d - Posicion: %d\n", i, pos[(size_t)i * paso_pos]);
+    }
+    for (int j = 0; j < n_sem; j++) {
+        printf("Semaforo %d - Estado: %s\n", j, estado_to_str((EstadoSemaforo)estado[j]));
+    }
+}
+
+// -------------------- Salida --------------------
+static inline int toca_emitir(const Salida *out, int iter) {
+    if (out->tipo == SALIDA_NINGUNA) return 0;
+    return out->cada <= 1 || (iter + 1) % out->cada == 0 || iter == out->ultimo;
+}
+
+// Primer tick >= iter que se emite (el último si no hay salida)
+static inline int proximo_emitido(const Salida *out, int iter) {
+    if (out->tipo == SALIDA_NINGUNA) return out->ultimo;
+    if (out->cada <= 1) return iter;
+    int t = (iter / out->cada + 1) * out->cada - 1;
+    return (t < out->ultimo) ? t : out->ultimo;
+}
+
+static void escribir_estado(Salida *out, const int *pos, size_t paso_pos, int n_veh, const unsigned char *estado, int n_sem, int iter) {
+    switch (out->tipo) {
+        case SALIDA_TEXTO:
+            imprimir_estado(pos, paso_pos, n_veh, estado, n_sem, iter);
+            break;
+        case SALIDA_BINARIA:
+            if (tray_escribir_frame(&out->tray, iter, pos, paso_pos, estado) != 0) {
+                fprintf(stderr, "Error escribiendo la trayectoria en la iteracion %d\n", iter + 1);
+                out->tipo = SALIDA_NINGUNA;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Reserva el anillo de frames. capacidad = 0 deja la salida síncrona.
+int trafico_crear_cola_salida(Salida *out, int capacidad, int descartar) {
+    ColaSalida *c = &out->cola;
+    memset(c, 0, sizeof(*c));
+    c->descartar = descartar;
+    if (capacidad <= 0 || out->tipo == SALIDA_NINGUNA) return 0;
+    c->frames = (FrameSalida*)calloc(capacidad, sizeof(FrameSalida));
+    if (!c->frames) return -1;
+    c->capacidad = capacidad;
+    for (int k = 0; k < capacidad; k++) {
+        c->frames[k].pos = (int*)malloc(sizeof(int) * out->n_veh);
+        c->frames[k].estado = (unsigned char*)malloc(out->n_sem);
+        if (!c->frames[k].pos || !c->frames[k].estado) return -1;
+    }
+    return 0;
+}
+
+void trafico_liberar_cola_salida(Salida *out) {
+    ColaSalida *c = &out->cola;
+    for (int k = 0; c->frames && k < c->capacidad; k++) {
+        free(c->frames[k].pos);
+        free(c->frames[k].estado);
+    }
+    free(c->frames);
+    c->frames = NULL;
+    c->capacidad = 0;
+}
+
+// Lado productor: copia el tick al anillo. Sólo bloquea si el anillo está lleno
+// y la política es bloquear.
+void trafico_emitir_estado(Salida *out, const int *pos, size_t paso_pos, int n_veh, const unsigned char *estado, int n_sem, int iter) {
+    ColaSalida *c = &out->cola;
+    if (!toca_emitir(out, iter)) return;
+    if (c->capacidad == 0) {
+        escribir_estado(out, pos, paso_pos, n_veh, estado, n_sem, iter);
+        return;
+    }
+    long long prod = c->producidos, cons;
+    for (;;) {
+        #pragma omp atomic read seq_cst
+        cons = c->consumidos;
+        if (prod - cons < c->capacidad) break;
+        if (c->descartar) {
+            c->descartados++;
+            return;
+        }
+        PAUSA_BREVE();
+    }
+    FrameSalida *f = &c->frames[prod % c->capacidad];
+    f->iter = iter;
+    for (int i = 0; i < n_veh; i++) {
+        f->pos[i] = pos[(size_t)i * paso_pos];
+    }
+    memcpy(f->estado, estado, n_sem);
+    #pragma omp atomic write seq_cst
+    c->producidos = prod + 1;
+}
+
+// Lado productor: no habrá más frames
+void trafico_cerrar_cola_salida(Salida *out) {
+    #pragma omp atomic write seq_cst
+    out->cola.cerrada = 1;
+}
+
+// Lado consumidor (hilo escritor): vacía el anillo hasta que se cierre
+void trafico_drenar_cola_salida(Salida *out) {
+    ColaSalida *c = &out->cola;
+    long long cons = c->consumidos;
+    for (;;) {
+        int cerrada;
+        long long prod;
+        #pragma omp atomic read seq_cst
+        cerrada = c->cerrada;
+        #pragma omp atomic read seq_cst
+        prod = c->producidos;
+        if (cons == prod) {
+            if (cerrada) break;
+            PAUSA_BREVE();
+            continue;
+        }
+        FrameSalida *f = &c->frames[cons % c->capacidad];
+        escribir_estado(out, f->pos, 1, out->n_veh, f->estado, out->n_sem, f->iter);
+        cons++;
+        #pragma omp atomic write seq_cst
+        c->consumidos = cons;
+    }
+}
+
+// -------------------- Instrumentación por fase --------------------
+typedef enum {
+    FASE_SEMAFOROS = 0,
+    FASE_SNAPSHOT,      // publicar/intercambiar el estado que lee el movimiento
+    FASE_MOVIMIENTO,
+    FASE_SALIDA,
+    FASE_DELAY,
+    FASE_ORDEN,         // medir desorden y reordenar por posición (motores SoA)
+    FASE_CONTROL,       // copiar el estado para el punto de control
+    FASE_TICK,          // tick completo (con secciones las fases se solapan)
+    N_FASES
+} Fase;
+
+static const char *NOMBRE_FASE[N_FASES] = {
+    "semaforos", "snapshot", "movimiento", "salida", "delay", "orden", "control", "tick"
+};
+
+int trafico_crear_metricas(Metricas *m, int iteraciones) {
+    m->iteraciones = iteraciones;
+    m->inicio = 0;
+    m->t = (double*)calloc((size_t)iteraciones * N_FASES, sizeof(double));
+    return m->t ? 0 : -1;
+}
+
+void trafico_liberar_metricas(Metricas *m) {
+    free(m->t);
+    m->t = NULL;
+}
+
+static inline void sumar_fase(Metricas *m, int iter, Fase f, double dt) {
+    if (m) m->t[(size_t)iter * N_FASES + f] += dt;
+}
+
+// Carga a la fase f el tiempo desde *marca y mueve la marca al instante actual
+static inline void medir_fase(Metricas *m, int iter, Fase f, double *marca) {
+    if (!m) return;
+    double ahora = omp_get_wtime();
+    sumar_fase(m, iter, f, ahora - *marca);
+    *marca = ahora;
+}
+
+static int comparar_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Reporte JSON con totales y min/mediana/p99 por tick de cada fase
+int trafico_escribir_reporte(const Metricas *m, const char *ruta, const char *motor, long long n_veh, int n_sem, long long road_len, double t_total) {
+    FILE *f = fopen(ruta, "w");
+    if (!f) return -1;
+    int n = m->iteraciones - m->inicio;
+    const double *t = m->t + (size_t)m->inicio * N_FASES;
+    double *orden = (double*)malloc(sizeof(double) * (n > 0 ? n : 1));
+    if (!orden) {
+        fclose(f);
+        return -1;
+    }
+    double total_mov = 0.0;
+    for (int i = 0; i < n; i++) total_mov += t[(size_t)i * N_FASES + FASE_MOVIMIENTO];
+    double actualizaciones = (double)n_veh * n;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"motor\": \"%s\",\n", motor);
+    fprintf(f, "  \"isa\": \"%s\",\n", trafico_isa());
+    fprintf(f, "  \"hilos\": %d,\n", omp_get_max_threads());
+    fprintf(f, "  \"vehiculos\": %lld,\n", n_veh);
+    fprintf(f, "  \"semaforos\": %d,\n", n_sem);
+    fprintf(f, "  \"largo\": %lld,\n", road_len);
+    fprintf(f, "  \"tick_inicial\": %d,\n", m->inicio);
+    fprintf(f, "  \"iteraciones\": %d,\n", n);
+    fprintf(f, "  \"tiempo_total_s\": %.9f,\n", t_total);
+    fprintf(f, "  \"actualizaciones_vehiculo_por_s\": %.3f,\n", t_total > 0 ? actualizaciones / t_total : 0.0);
+    fprintf(f, "  \"actualizaciones_vehiculo_por_s_movimiento\": %.3f,\n", total_mov > 0 ? actualizaciones / total_mov : 0.0);
+    fprintf(f, "  \"fases\": {\n");
+    for (int fase = 0; fase < N_FASES; fase++) {
+        double total = 0.0;
+        for (int i = 0; i < n; i++) {
+            orden[i] = t[(size_t)i * N_FASES + fase];
+            total += orden[i];
+        }
+        if (n == 0) orden[0] = 0.0;    // reanudado en el último tick: nada medido
+        qsort(orden, n, sizeof(double), comparar_double);
+        double mediana = (n % 2 || n == 0) ? orden[n / 2] : 0.5 * (orden[n / 2 - 1] + orden[n / 2]);
+        int k99 = (int)((99.0 * n + 99) / 100) - 1; // rango más cercano: ceil(0.99 n) - 1
+        int ultimo = (n > 0) ? n - 1 : 0;
+        fprintf(f, "    \"%s\": { \"total_s\": %.9f, \"min_s\": %.9f, \"mediana_s\": %.9f, \"p99_s\": %.9f, \"max_s\": %.9f }%s\n",
+                NOMBRE_FASE[fase], total, orden[0], mediana, orden[k99 > 0 ? k99 : 0], orden[ultimo],
+                (fase + 1 < N_FASES) ? "," : "");
+    }
+    fprintf(f, "  }\n}\n");
+    free(orden);
+    return (fclose(f) == 0) ? 0 : -1;
+}
+
+// 0 si corrió; -1 sin memoria para el estado de los semáforos (nada avanzó)
+int trafico_simular_simple(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, Salida *out, Metricas *met) {
+    EstadoSemaforos est;
+    if (crear_estado_semaforos(&est, s, n_sem) != 0) return -1;
+
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+
+        // Actualizar semáforos, publicando el nuevo estado en el buffer libre
+        actualizar_semaforos(s, n_sem, estado_siguiente(&est));
+        medir_fase(met, i, FASE_SEMAFOROS, &marca);
+
+        // Mover vehículos leyendo el estado recién publicado (ya estable)
+        mover_vehiculos(v, n_veh, estado_siguiente(&est), celda_sem, road_len);
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+        intercambiar_estado(&est);
+        medir_fase(met, i, FASE_SNAPSHOT, &marca);
+
+        // Mostrar estado
+        trafico_emitir_estado(out, &v[0].pos, PASO_VEHICULO, n_veh, estado_actual(&est), n_sem, i);
+        medir_fase(met, i, FASE_SALIDA, &marca);
+
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    liberar_estado_semaforos(&est);
+    return 0;
+}
+// -------------------- Archivos de estado --------------------
+static inline uint64_t alinear_64(uint64_t x) {
+    return (x + ALINEACION_BYTES - 1) / ALINEACION_BYTES * ALINEACION_BYTES;
+}
+
+// Escribe el contenedor en ruta.tmp y lo renombra a ruta, así que un corte a
+// mitad de la escritura deja el archivo anterior intacto
+int trafico_escribir_archivo_estado(const char *ruta, const char *magic, const Vehiculo *v, int n_veh, const Semaforo *s, int n_sem,
+                                    int road_len, long long tick, unsigned int semilla) {
+    CabeceraEstado c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.magic, magic, 4);
+    c.version = ESTADO_VERSION;
+    c.marca_orden = ESTADO_MARCA_ORDEN;
+    c.bytes_vehiculo = sizeof(Vehiculo);
+    c.bytes_semaforo = sizeof(Semaforo);
+    c.n_veh = (uint32_t)n_veh;
+    c.n_sem = (uint32_t)n_sem;
+    c.largo = (uint32_t)road_len;
+    c.tick = (uint64_t)tick;
+    c.semilla = semilla;
+    c.off_vehiculos = alinear_64(sizeof(c));
+    c.off_semaforos = alinear_64(c.off_vehiculos + sizeof(Vehiculo) * (uint64_t)n_veh);
+
+    size_t n_ruta = strlen(ruta);
+    char *tmp = (char*)malloc(n_ruta + 5);
+    if (!tmp) return -1;
+    memcpy(tmp, ruta, n_ruta);
+    memcpy(tmp + n_ruta, ".tmp", 5);
+    FILE *f = fopen(tmp, "wb");
+    static const unsigned char ceros[ALINEACION_BYTES] = { 0 };
+    int ok = f != NULL &&
+             fwrite(&c, sizeof(c), 1, f) == 1 &&
+             fwrite(ceros, 1, c.off_vehiculos - sizeof(c), f) == c.off_vehiculos - sizeof(c) &&
+             fwrite(v, sizeof(Vehiculo), n_veh, f) == (size_t)n_veh &&
+             fwrite(ceros, 1, c.off_semaforos - c.off_vehiculos - sizeof(Vehiculo) * (uint64_t)n_veh, f) ==
+                 c.off_semaforos - c.off_vehiculos - sizeof(Vehiculo) * (uint64_t)n_veh &&
+             fwrite(s, sizeof(Semaforo), n_sem, f) == (size_t)n_sem;
+    if (f && fclose(f) != 0) ok = 0;
+    if (ok && RENOMBRAR(tmp, ruta) != 0) ok = 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+    return ok ? 0 : -1;
+}
+
+int trafico_mapear_archivo(ArchivoMapeado *m, const char *ruta) {
+    memset(m, 0, sizeof(*m));
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER tam;
+    m->archivo = CreateFileA(ruta, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->archivo == INVALID_HANDLE_VALUE) return -1;
+    if (!GetFileSizeEx(m->archivo, &tam) || tam.QuadPart == 0) {
+        CloseHandle(m->archivo);
+        return -1;
+    }
+    m->bytes = (size_t)tam.QuadPart;
+    m->mapeo = CreateFileMappingA(m->archivo, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    m->base = m->mapeo ? (unsigned char*)MapViewOfFile(m->mapeo, FILE_MAP_COPY, 0, 0, 0) : NULL;
+    if (!m->base) {
+        if (m->mapeo) CloseHandle(m->mapeo);
+        CloseHandle(m->archivo);
+        return -1;
+    }
+#else
+    int fd = open(ruta, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    m->bytes = (size_t)st.st_size;
+    void *p = mmap(NULL, m->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    m->base = (unsigned char*)p;
+#endif
+    return 0;
+}
+
+void trafico_desmapear_archivo(ArchivoMapeado *m) {
+    if (!m->base) return;
+#if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->mapeo);
+    CloseHandle(m->archivo);
+#else
+    munmap(m->base, m->bytes);
+#endif
+    m->base = NULL;
+}
+
+// Valida en paralelo; devuelve cuántas entradas son inválidas
+static long long contar_fuera_de_rango(const Vehiculo *v, int n_veh, const Semaforo *s, int n_sem, int largo) {
+    long long malos = 0;
+    #pragma omp parallel for schedule(static) reduction(+:malos)
+    for (int i = 0; i < n_veh; i++) {
+        malos += (v[i].id != i || v[i].pos < 0 || v[i].pos >= largo || v[i].vel_max < 1 || v[i].vel_max > largo);
+    }
+    #pragma omp parallel for schedule(static) reduction(+:malos)
+    for (int j = 0; j < n_sem; j++) {
+        int dur = (s[j].estado == VERDE) ? s[j].dur_verde : (s[j].estado == AMARILLO) ? s[j].dur_amarillo : s[j].dur_rojo;
+        malos += (s[j].id != j || s[j].pos < 0 || s[j].pos >= largo ||
+                  s[j].dur_verde < 1 || s[j].dur_amarillo < 1 || s[j].dur_rojo < 1 ||
+                  (long long)s[j].dur_verde + s[j].dur_amarillo + s[j].dur_rojo > INT_MAX ||
+                  (s[j].estado != VERDE && s[j].estado != AMARILLO && s[j].estado != ROJO) ||
+                  s[j].t_en_estado < 0 || s[j].t_en_estado >= dur);
+    }
+    return malos;
+}
+
+// Cabecera del contenedor si es de esta plataforma, sus secciones caben en el
+// archivo y todos los vehículos y semáforos están en rango; NULL si no
+const CabeceraEstado *trafico_validar_archivo_estado(const ArchivoMapeado *m, const char *magic) {
+    if (m->bytes < sizeof(CabeceraEstado)) return NULL;
+    const CabeceraEstado *c = (const CabeceraEstado*)m->base;
+    if (memcmp(c->magic, magic, 4) != 0 || c->version != ESTADO_VERSION || c->marca_orden != ESTADO_MARCA_ORDEN ||
+        c->bytes_vehiculo != sizeof(Vehiculo) || c->bytes_semaforo != sizeof(Semaforo) ||
+        c->n_veh > INT_MAX || c->n_sem > INT_MAX || c->largo > INT_MAX ||
+        c->off_vehiculos % ALINEACION_BYTES != 0 || c->off_semaforos % ALINEACION_BYTES != 0 ||
+        c->off_vehiculos < sizeof(CabeceraEstado) ||
+        c->off_vehiculos + (uint64_t)c->n_veh * sizeof(Vehiculo) > m->bytes ||
+        c->off_semaforos + (uint64_t)c->n_sem * sizeof(Semaforo) > m->bytes) {
+        return NULL;
+    }
+    const Vehiculo *v = (const Vehiculo*)(m->base + c->off_vehiculos);
+    const Semaforo *s = (const Semaforo*)(m->base + c->off_semaforos);
+    if (contar_fuera_de_rango(v, (int)c->n_veh, s, (int)c->n_sem, (int)c->largo) > 0) return NULL;
+    return c;
+}
+
+// -------------------- Puntos de control --------------------
+// Cada `cada` ticks trafico_simular_dinamico copia vehículos y semáforos a un segundo
+// buffer (una copia paralela al final del tick) y sigue; el hilo escritor de
+// correr_con_escritor serializa esa copia con trafico_escribir_archivo_estado. Si el
+// escritor todavía no terminó con la copia anterior, el tick espera. Sin hilo
+// escritor (asincrono = 0) el archivo se escribe dentro del tick.
+// El modelo no consume números aleatorios después de inicializar, así que el
+// estado del generador es la semilla: Philox sólo depende de ella y del tick.
+int trafico_crear_punto_control(PuntoControl *pc, const char *ruta, int cada, int n_veh, int n_sem, int road_len, unsigned int semilla) {
+    memset(pc, 0, sizeof(*pc));
+    pc->ruta = ruta;
+    pc->cada = cada;
+    pc->semilla = semilla;
+    pc->largo = road_len;
+    pc->n_veh = n_veh;
+    pc->n_sem = n_sem;
+    if (cada <= 0) return 0;
+    pc->veh = (Vehiculo*)malloc(sizeof(Vehiculo) * (n_veh > 0 ? n_veh : 1));
+    pc->sem = (Semaforo*)malloc(sizeof(Semaforo) * (n_sem > 0 ? n_sem : 1));
+    if (!pc->veh || !pc->sem) {
+        free(pc->veh);
+        free(pc->sem);
+        pc->veh = NULL;
+        pc->sem = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void trafico_liberar_punto_control(PuntoControl *pc) {
+    free(pc->veh);
+    free(pc->sem);
+    pc->veh = NULL;
+    pc->sem = NULL;
+}
+
+static void escribir_copia_control(PuntoControl *pc) {
+    if (trafico_escribir_archivo_estado(pc->ruta, ESTADO_MAGIC_CONTROL, pc->veh, pc->n_veh, pc->sem, pc->n_sem,
+                                        pc->largo, pc->tick, pc->semilla) != 0) {
+        fprintf(stderr, "No se pudo escribir el punto de control %s (tick %lld)\n", pc->ruta, pc->tick);
+        pc->error = 1;
+    }
+}
+
+// Lado del motor, al terminar el tick iter
+static void pedir_punto_control(PuntoControl *pc, int iter, const Vehiculo *v, const Semaforo *s) {
+    if (!pc || pc->cada <= 0 || (iter + 1) % pc->cada != 0) return;
+    int pendiente = 1;
+    while (pc->asincrono && pendiente) {
+        #pragma omp atomic read seq_cst
+        pendiente = pc->pendiente;
+        if (pendiente) PAUSA_BREVE();
+    }
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < pc->n_veh; i++) {
+        pc->veh[i] = v[i];
+    }
+    memcpy(pc->sem, s, sizeof(Semaforo) * pc->n_sem);
+    pc->tick = (long long)iter + 1;
+    if (!pc->asincrono) {
+        escribir_copia_control(pc);
+        return;
+    }
+    #pragma omp atomic write seq_cst
+    pc->pendiente = 1;
+}
+
+// Lado del motor: no habrá más puntos
+void trafico_cerrar_punto_control(PuntoControl *pc) {
+    #pragma omp atomic write seq_cst
+    pc->cerrado = 1;
+}
+
+// Hilo escritor: serializa cada copia pedida hasta que se cierre
+void trafico_escribir_puntos_control(PuntoControl *pc) {
+    for (;;) {
+        int pendiente, cerrado;
+        #pragma omp atomic read seq_cst
+        cerrado = pc->cerrado;
+        #pragma omp atomic read seq_cst
+        pendiente = pc->pendiente;
+        if (!pendiente) {
+            if (cerrado) break;
+            PAUSA_BREVE();
+            continue;
+        }
+        escribir_copia_control(pc);
+        #pragma omp atomic write seq_cst
+        pc->pendiente = 0;
+    }
+}
+
+// -------------------- Ajuste dinámico de hilos --------------------
+// Con ajuste_dinamico = 0 (modo NUMA) respeta el número de hilos y su ubicación.
+// Con pc arranca en el tick pc->inicio (al reanudar) y pide sus puntos de control.
+// 0 si corrió; -1 sin memoria para el estado de los semáforos (nada avanzó).
+int trafico_simular_dinamico(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, int usar_secciones,
+                             int ajuste_dinamico, PuntoControl *pc, Salida *out, Metricas *met) {
+    if (ajuste_dinamico) {
+        omp_set_dynamic(1); // permitir ajuste dinámico
+        omp_set_num_threads(8);
+    }
+    EstadoSemaforos est;
+    if (crear_estado_semaforos(&est, s, n_sem) != 0) return -1;
+
+    for (int i = pc ? pc->inicio : 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        if (usar_secciones) {
+            // La sección de "mover" lee el estado previo (buffer actual) mientras
+            // la de semáforos publica el nuevo en el otro buffer.
+            // Cada sección mide su propio tiempo: se solapan dentro del tick.
+            #pragma omp parallel sections
+            {
+                #pragma omp section
+                {
+                    double t = omp_get_wtime();
+                    actualizar_semaforos(s, n_sem, estado_siguiente(&est));
+                    sumar_fase(met, i, FASE_SEMAFOROS, omp_get_wtime() - t);
+                }
+                #pragma omp section
+                {
+                    double t = omp_get_wtime();
+                    mover_vehiculos(v, n_veh, estado_actual(&est), celda_sem, road_len);
+                    sumar_fase(met, i, FASE_MOVIMIENTO, omp_get_wtime() - t);
+                }
+            }
+            marca = omp_get_wtime();
+        } else {
+            // Secuencial por iteración (pero cada tarea interna está paralelizada)
+            actualizar_semaforos(s, n_sem, estado_siguiente(&est));
+            medir_fase(met, i, FASE_SEMAFOROS, &marca);
+            mover_vehiculos(v, n_veh, estado_siguiente(&est), celda_sem, road_len);
+            medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+        }
+        intercambiar_estado(&est);
+        medir_fase(met, i, FASE_SNAPSHOT, &marca);
+
+        trafico_emitir_estado(out, &v[0].pos, PASO_VEHICULO, n_veh, estado_actual(&est), n_sem, i);
+        medir_fase(met, i, FASE_SALIDA, &marca);
+        pedir_punto_control(pc, i, v, s);
+        medir_fase(met, i, FASE_CONTROL, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    liberar_estado_semaforos(&est);
+    return 0;
+}
+// -------------------- Región paralela persistente --------------------
+// Una sola región paralela para toda la corrida: las fases se reparten con
+// worksharing huérfano y se separan con barreras, así cada tick no paga el
+// fork/join ni el anidamiento de trafico_simular_dinamico.
+// Con usar_secciones el movimiento lee el estado previo de los semáforos
+// (como las secciones de trafico_simular_dinamico) y ambas fases corren sin barrera
+// entre ellas; sin secciones, el movimiento ve el estado ya actualizado.
+void trafico_simular_persistente(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, int usar_secciones, Salida *out, Metricas *met) {
+    EstadoSemaforos est;
+    if (crear_estado_semaforos(&est, s, n_sem) != 0) return;
+
+    // Las marcas las toma el hilo 0; con secciones, la fase de semáforos es su
+    // parte del reparto y el resto hasta la barrera se carga al movimiento.
+    #pragma omp parallel
+    {
+        int mide = (met != NULL && omp_get_thread_num() == 0);
+        for (int i = 0; i < iteraciones; i++) {
+            double inicio = 0.0, marca = 0.0;
+            if (mide) inicio = marca = omp_get_wtime();
+            if (usar_secciones) {
+                actualizar_semaforos_for(s, n_sem, estado_siguiente(&est));
+                if (mide) medir_fase(met, i, FASE_SEMAFOROS, &marca);
+                mover_vehiculos_for(v, n_veh, estado_actual(&est), celda_sem, road_len);
+                #pragma omp barrier
+                if (mide) medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+            } else {
+                actualizar_semaforos_for(s, n_sem, estado_siguiente(&est));
+                #pragma omp barrier
+                if (mide) medir_fase(met, i, FASE_SEMAFOROS, &marca);
+                mover_vehiculos_for(v, n_veh, estado_siguiente(&est), celda_sem, road_len);
+                #pragma omp barrier
+                if (mide) medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+            }
+
+            // Intercambio, salida y delay en un solo hilo; la barrera implícita
+            // del single evita que el siguiente tick modifique lo que se imprime.
+            #pragma omp single
+            {
+                double m = omp_get_wtime();
+                intercambiar_estado(&est);
+                medir_fase(met, i, FASE_SNAPSHOT, &m);
+                trafico_emitir_estado(out, &v[0].pos, PASO_VEHICULO, n_veh, estado_actual(&est), n_sem, i);
+                medir_fase(met, i, FASE_SALIDA, &m);
+                if (delay_seg > 0) SLEEP_SEC(delay_seg);
+                medir_fase(met, i, FASE_DELAY, &m);
+            }
+            if (mide) sumar_fase(met, i, FASE_TICK, omp_get_wtime() - inicio);
+        }
+    }
+    liberar_estado_semaforos(&est);
+}
+// -------------------- Motor SoA --------------------
+// Mismo orden de fases que trafico_simular_simple, con el kernel vectorizado.
+// El arreglo por celda hace de snapshot: se publica completo antes de mover.
+void trafico_simular_soa(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg,
+                         OrdenVehiculos *orden, Salida *out, Metricas *met) {
+    int *estado_celda = (int*)alloc_alineado(sizeof(int) * road_len);
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < road_len; c++) {
+        estado_celda[c] = VERDE;
+    }
+
+    EstadoSemaforos est;
+    if (crear_estado_semaforos(&est, s, n_sem) != 0) {
+        liberar_alineado(estado_celda);
+        return;
+    }
+
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        actualizar_semaforos(s, n_sem, estado_siguiente(&est));
+        medir_fase(met, i, FASE_SEMAFOROS, &marca);
+        intercambiar_estado(&est);
+        publicar_estado_celdas(s, estado_actual(&est), n_sem, celda_sem, estado_celda);
+        medir_fase(met, i, FASE_SNAPSHOT, &marca);
+
+        mover_vehiculos_soa(v, estado_celda, road_len);
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+
+        if (toca_emitir(out, i)) {
+            trafico_emitir_estado(out, posiciones_por_id(v, orden), 1, v->n, estado_actual(&est), n_sem, i);
+        }
+        medir_fase(met, i, FASE_SALIDA, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        mantener_orden(v, orden, road_len, i);
+        medir_fase(met, i, FASE_ORDEN, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    liberar_estado_semaforos(&est);
+    liberar_alineado(estado_celda);
+}
+// -------------------- Motor analítico --------------------
+// Mismo resultado que trafico_simular_simple sin fase de semáforos: el tick i mueve con
+// el estado tras i + 1 actualizaciones, calculado en forma cerrada. El estado
+// de todos los semáforos sólo se arma si hay salida, y Semaforo[] se
+// sincroniza al final.
+void trafico_simular_analitico(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg,
+                               OrdenVehiculos *orden, Salida *out, Metricas *met) {
+    TablaCiclos tabla;
+    unsigned char *estado = (unsigned char*)malloc(n_sem);
+    int *desp = (int*)malloc(sizeof(int) * n_sem);  // a lo sumo un ciclo por semáforo
+    if (!estado || !desp || crear_tabla_ciclos(&tabla, s, n_sem) != 0) {
+        free(estado);
+        free(desp);
+        return;
+    }
+
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        long long k = (long long)i + 1;
+
+        desplazamientos_en_tick(&tabla, k, desp);
+        mover_vehiculos_analitico(v, &tabla, desp, celda_sem, road_len);
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+
+        if (toca_emitir(out, i)) {
+            estados_en_tick(&tabla, k, estado);
+            trafico_emitir_estado(out, posiciones_por_id(v, orden), 1, v->n, estado, n_sem, i);
+        }
+        medir_fase(met, i, FASE_SALIDA, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        mantener_orden(v, orden, road_len, i);
+        medir_fase(met, i, FASE_ORDEN, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    sincronizar_semaforos(&tabla, s, iteraciones);
+    liberar_tabla_ciclos(&tabla);
+    free(estado);
+    free(desp);
+}
+// -------------------- Conjunto de semillas --------------------
+// El mismo escenario con muchas semillas en un solo proceso. La semilla sólo
+// cambia los vehículos iniciales, así que todas las réplicas comparten el
+// estado de los semáforos (forma cerrada, publicado por celda una vez por
+// tick) y viven en una sola arena alineada: la réplica r ocupa
+// [r * n_pad, (r + 1) * n_pad) de pos y de vel_max.
+//
+// Con al menos tantas réplicas como hilos se reparte por réplica; si no, cada
+// réplica se parte en un bloque por hilo (réplicas x vehículos). Cada par
+// (réplica, bloque) suma en su propia entrada de parcial, así que las
+// estadísticas no dependen del reparto ni del número de hilos.
+void trafico_liberar_conjunto(Conjunto *c) {
+    liberar_alineado(c->arena);
+    free(c->avance);
+    free(c->detenidos);
+    memset(c, 0, sizeof(*c));
+}
+
+int trafico_crear_conjunto(Conjunto *c, const unsigned int *semillas, int n_rep, int n_veh, int road_len) {
+    memset(c, 0, sizeof(*c));
+    c->semillas = semillas;
+    c->n_rep = n_rep;
+    c->n_veh = n_veh;
+    c->n_pad = (n_veh + VEH_SOA_BLOQUE - 1) / VEH_SOA_BLOQUE * VEH_SOA_BLOQUE;
+    size_t total = (size_t)n_rep * c->n_pad;
+    c->arena = (int*)alloc_alineado(sizeof(int) * 2 * total);
+    c->avance = (long long*)calloc(n_rep, sizeof(long long));
+    c->detenidos = (long long*)calloc(n_rep, sizeof(long long));
+    if (!c->arena || !c->avance || !c->detenidos) {
+        trafico_liberar_conjunto(c);
+        return -1;
+    }
+    c->pos = c->arena;
+    c->vel_max = c->arena + total;
+    int espacio = (road_len > n_veh) ? (road_len / n_veh) : 1;
+    int n_pad = c->n_pad;
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (int r = 0; r < n_rep; r++) {
+        for (int i = 0; i < n_pad; i++) {
+            size_t k = (size_t)r * n_pad + i;
+            if (i < n_veh) {
+                vehiculo_inicial(i, espacio, road_len, semillas[r], &c->pos[k], &c->vel_max[k]);
+            } else {
+                c->pos[k] = 0;
+                c->vel_max[k] = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+// Kernel de mover_vehiculos_soa sobre [i0, i1) de una réplica, con sus estadísticas
+static inline void mover_bloque_conjunto(int *restrict pos, const int *restrict vel, int i0, int i1,
+                                         const int *estado_celda, int road_len, long long *acum) {
+    long long avance = 0, detenidos = 0;
+    #pragma omp simd reduction(+:avance, detenidos)
+    for (int i = i0; i < i1; i++) {
+        int destino = mod_pos_paso(pos[i] + vel[i], road_len);
+        int verde = (estado_celda[destino] == VERDE);
+        pos[i] = verde ? destino : pos[i];
+        avance += verde ? vel[i] : 0;
+        detenidos += !verde;
+    }
+    acum[0] += avance;
+    acum[1] += detenidos;
+}
+
+// 0 si corrió; -1 sin memoria (avance y detenidos no cambian)
+int trafico_simular_conjunto(int iteraciones, Conjunto *cj, const Semaforo *s, int n_sem, const int *celda_sem, int road_len, Metricas *met) {
+    int bloques = (cj->n_rep >= omp_get_max_threads()) ? 1 : omp_get_max_threads();
+    TablaCiclos tabla;
+    unsigned char *estado = (unsigned char*)malloc(n_sem);
+    int *estado_celda = (int*)alloc_alineado(sizeof(int) * road_len);
+    long long *parcial = (long long*)calloc((size_t)2 * cj->n_rep * bloques, sizeof(long long));
+    if (!estado || !estado_celda || !parcial || crear_tabla_ciclos(&tabla, s, n_sem) != 0) {
+        fprintf(stderr, "Sin memoria para el conjunto de semillas\n");
+        free(estado);
+        liberar_alineado(estado_celda);
+        free(parcial);
+        return -1;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < road_len; c++) {
+        estado_celda[c] = VERDE;
+    }
+
+    int n_rep = cj->n_rep, n_veh = cj->n_veh, n_pad = cj->n_pad;
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        estados_en_tick(&tabla, (long long)i + 1, estado);
+        publicar_estado_celdas(s, estado, n_sem, celda_sem, estado_celda);
+        medir_fase(met, i, FASE_SEMAFOROS, &marca);
+
+        #pragma omp parallel for collapse(2) schedule(static)
+        for (int r = 0; r < n_rep; r++) {
+            for (int b = 0; b < bloques; b++) {
+                size_t base = (size_t)r * n_pad;
+                mover_bloque_conjunto(cj->pos + base, cj->vel_max + base,
+                                      (int)((long long)n_veh * b / bloques), (int)((long long)n_veh * (b + 1) / bloques),
+                                      estado_celda, road_len, &parcial[2 * ((size_t)r * bloques + b)]);
+            }
+        }
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    for (int r = 0; r < n_rep; r++) {
+        for (int b = 0; b < bloques; b++) {
+            cj->avance[r] += parcial[2 * ((size_t)r * bloques + b)];
+            cj->detenidos[r] += parcial[2 * ((size_t)r * bloques + b) + 1];
+        }
+    }
+    liberar_tabla_ciclos(&tabla);
+    free(estado);
+    liberar_alineado(estado_celda);
+    free(parcial);
+    return 0;
+}
+
+// Una fila por semilla (CSV) y, en stdout, media, mínimo y máximo de las réplicas
+void trafico_reportar_conjunto(const Conjunto *cj, int iteraciones, FILE *csv) {
+    double vehiculo_ticks = (double)cj->n_veh * iteraciones;
+    double suma_v = 0, min_v = 0, max_v = 0, suma_d = 0, min_d = 0, max_d = 0;
+    fprintf(csv, "semilla,avance_celdas,velocidad_media,fraccion_detenida\n");
+    for (int r = 0; r < cj->n_rep; r++) {
+        double v = cj->avance[r] / vehiculo_ticks;
+        double d = cj->detenidos[r] / vehiculo_ticks;
+        fprintf(csv, "%u,%lld,%.6f,%.6f\n", cj->semillas[r], cj->avance[r], v, d);
+        suma_v += v;
+        suma_d += d;
+        if (r == 0 || v < min_v) min_v = v;
+        if (r == 0 || v > max_v) max_v = v;
+        if (r == 0 || d < min_d) min_d = d;
+        if (r == 0 || d > max_d) max_d = d;
+    }
+    printf("Semillas: %d | Velocidad media: %.6f [%.6f, %.6f] | Fraccion detenida: %.6f [%.6f, %.6f]\n",
+           cj->n_rep, suma_v / cj->n_rep, min_v, max_v, suma_d / cj->n_rep, min_d, max_d);
+}
+// -------------------- Optimizador de onda verde --------------------
+// Busca desfases por semáforo (y con repartos, cuánto del ciclo es verde y
+// cuánto rojo) que maximicen el avance de los vehículos o minimicen las
+// detenciones. Cada ronda genera candidatos mutando el mejor plan y los puntúa
+// en paralelo, un candidato por hilo a la vez, simulando todos los ticks con
+// el estado de semáforos en forma cerrada (ver TablaCiclos). La ronda 0 incluye
+// el plan inicial y una onda verde a la velocidad media. Las mutaciones salen
+// de Philox con (semáforo, 1 + ronda * candidatos + candidato), así que el
+// resultado no depende del número de hilos.
+// 1 si a es mejor que b (con paradas se minimizan las detenciones)
+static inline int mejor_puntaje(Puntaje a, Puntaje b, int paradas) {
+    if (paradas) return a.detenidos < b.detenidos || (a.detenidos == b.detenidos && a.avance > b.avance);
+    return a.avance > b.avance || (a.avance == b.avance && a.detenidos < b.detenidos);
+}
+
+// Un tick de un candidato: el paso de mover_analitico en serie (el paralelismo
+// está en los candidatos), sumando avance y detenciones
+#define DEFINIR_PUNTUAR_TICK(isa, ATRIB) \
+ATRIB static void puntuar_tick_##isa(int *restrict pos, const int *restrict vel, int n, const TablaCiclos *t, \
+                                     const int *desp, const int *celda_sem, int road_len, Puntaje *p) { \
+    long long avance = 0, detenidos = 0; \
+    for (int i = 0; i < n; i++) { \
+        int destino; \
+        int verde = paso_analitico(pos[i], vel[i], t, desp, celda_sem, road_len, &destino); \
+        pos[i] = verde ? destino : pos[i]; \
+        avance += verde ? vel[i] : 0; \
+        detenidos += !verde; \
+    } \
+    p->avance += avance; \
+    p->detenidos += detenidos; \
+}
+ISA_VARIANTES(DEFINIR_PUNTUAR_TICK)
+
+static void (*const PUNTUAR_TICK[N_ISA])(int*, const int*, int, const TablaCiclos*, const int*, const int*, int, Puntaje*) =
+    ISA_TABLA(puntuar_tick);
+
+// Simula el plan en serie sobre pos (copia de pos0); -1 sin memoria
+static int puntuar_plan(const Semaforo *plan, int n_sem, const int *celda_sem, const int *pos0, const int *vel, int n_veh,
+                        int road_len, int iteraciones, int *pos, int *desp, Puntaje *p) {
+    TablaCiclos t;
+    if (crear_tabla_ciclos(&t, plan, n_sem) != 0) return -1;
+    memcpy(pos, pos0, sizeof(int) * n_veh);
+    p->avance = p->detenidos = 0;
+    for (long long k = 1; k <= iteraciones; k++) {
+        desplazamientos_en_tick(&t, k, desp);
+        PUNTUAR_TICK[isa_activa](pos, vel, n_veh, &t, desp, celda_sem, road_len, p);
+    }
+    liberar_tabla_ciclos(&t);
+    return 0;
+}
+
+// Desfases de una onda verde: el verde del semáforo en pos empieza cuando llega
+// un vehículo que salió de la celda 0 en el tick 0 a velocidad vel_media
+static void onda_verde(Semaforo *plan, int n_sem, double vel_media) {
+    for (int j = 0; j < n_sem; j++) {
+        int ciclo = plan[j].dur_verde + plan[j].dur_amarillo + plan[j].dur_rojo;
+        poner_fase_semaforo(&plan[j], mod_pos(-(int)(plan[j].pos / vel_media), ciclo));
+    }
+}
+
+// Cambia el desfase de ~1/4 de los semáforos de base y, con repartos, mueve
+// un tick entre verde y rojo en otro ~1/4 (mismo ciclo y amarillo)
+static void mutar_plan(const Semaforo *base, Semaforo *cand, int n_sem, int repartos, uint32_t contador, unsigned int seed) {
+    for (int j = 0; j < n_sem; j++) {
+        uint32_t a[2];
+        philox2x32((uint32_t)j, contador, seed, a);
+        Semaforo s = base[j];
+        int ciclo = s.dur_verde + s.dur_amarillo + s.dur_rojo;
+        int fase = fase_de_semaforo(&s);
+        if ((a[0] & 3u) == 0) fase = (int)(a[1] % (uint32_t)ciclo);
+        if (repartos && ((a[0] >> 2) & 3u) == 0) {
+            int verde = s.dur_verde + (((a[0] >> 4) & 1u) ? 1 : -1);
+            if (verde >= 1 && ciclo - s.dur_amarillo - verde >= 1) {
+                s.dur_verde = verde;
+                s.dur_rojo = ciclo - s.dur_amarillo - verde;
+            }
+        }
+        poner_fase_semaforo(&s, fase);
+        cand[j] = s;
+    }
+}
+
+// Deja en plan el mejor encontrado y en *mejor su puntaje; -1 sin memoria
+int trafico_optimizar_plan(Semaforo *plan, int n_sem, const int *celda_sem, const VehiculosSoA *v, int road_len, int iteraciones,
+                           int n_cand, int rondas, int paradas, int repartos, unsigned int seed, Puntaje *mejor) {
+    Semaforo *cand = (Semaforo*)malloc(sizeof(Semaforo) * (size_t)n_cand * n_sem);
+    Puntaje *punt = (Puntaje*)malloc(sizeof(Puntaje) * n_cand);
+    if (!cand || !punt) {
+        free(cand);
+        free(punt);
+        return -1;
+    }
+    double vel_media = 0.0;
+    for (int i = 0; i < v->n; i++) vel_media += v->vel_max[i];
+    vel_media = (v->n > 0) ? vel_media / v->n : 1.0;
+
+    int error = 0;
+    for (int r = 0; r <= rondas && !error; r++) {
+        #pragma omp parallel
+        {
+            int *pos = (int*)malloc(sizeof(int) * (v->n > 0 ? v->n : 1));
+            int *desp = (int*)malloc(sizeof(int) * n_sem);
+            #pragma omp for schedule(dynamic, 1)
+            for (int c = 0; c < n_cand; c++) {
+                Semaforo *p = cand + (size_t)c * n_sem;
+                if (r == 0 && c < 2) {
+                    memcpy(p, plan, sizeof(Semaforo) * n_sem);
+                    if (c == 1) onda_verde(p, n_sem, vel_media);
+                } else {
+                    mutar_plan(plan, p, n_sem, repartos, 1u + (uint32_t)r * (uint32_t)n_cand + (uint32_t)c, seed);
+                }
+                if (!pos || !desp ||
+                    puntuar_plan(p, n_sem, celda_sem, v->pos, v->vel_max, v->n, road_len, iteraciones, pos, desp, &punt[c]) != 0) {
+                    #pragma omp atomic write
+                    error = 1;
+                }
+            }
+            free(pos);
+            free(desp);
+        }
+        if (error) break;
+        int elegido = -1;
+        for (int c = 0; c < n_cand; c++) {
+            if ((r == 0 && c == 0) || mejor_puntaje(punt[c], *mejor, paradas)) {
+                *mejor = punt[c];
+                elegido = c;
+            }
+        }
+        if (elegido >= 0) memcpy(plan, cand + (size_t)elegido * n_sem, sizeof(Semaforo) * n_sem);
+        printf("Ronda %d: avance %lld | detenidos %lld%s\n", r, mejor->avance, mejor->detenidos,
+               (r > 0 && elegido >= 0) ? " (mejora)" : "");
+    }
+    free(cand);
+    free(punt);
+    return error ? -1 : 0;
+}
+
+// -------------------- Escenarios --------------------
+// Escenario en texto, una entrada por línea ('#' comenta hasta el fin de línea):
+//   largo L
+//   semaforo pos verde amarillo rojo desfase   desfase: fase del ciclo en el
+//                                              tick 0 (0 = empieza el verde)
+//   vehiculo pos vel                           el id es el orden en el archivo
+// El binario es el contenedor de los puntos de control con magic "TRES" y se
+// mapea sin copiar: los motores trabajan sobre sus arreglos (copia al escribir).
+void trafico_liberar_escenario(Escenario *e) {
+    if (e->mapa.base) {
+        trafico_desmapear_archivo(&e->mapa);
+    } else {
+        free(e->veh);
+        free(e->sem);
+    }
+    memset(e, 0, sizeof(*e));
+}
+
+static long long validar_escenario(const Escenario *e) {
+    return contar_fuera_de_rango(e->veh, e->n_veh, e->sem, e->n_sem, e->largo);
+}
+
+// Agrega off al arreglo creciente *v de *n elementos; -1 sin memoria
+static int agregar_linea(size_t **v, int *n, int *cap, size_t off) {
+    if (*n == *cap) {
+        int nueva = *cap ? 2 * *cap : 1024;
+        size_t *p = (size_t*)realloc(*v, sizeof(size_t) * nueva);
+        if (!p) return -1;
+        *v = p;
+        *cap = nueva;
+    }
+    (*v)[(*n)++] = off;
+    return 0;
+}
+
+// Lee n enteros de txt; devuelve 0 si están todos, entran en int y no sobra
+// nada en la línea
+static int leer_enteros(const char *txt, long *x, int n) {
+    char *fin;
+    for (int k = 0; k < n; k++) {
+        errno = 0;
+        x[k] = strtol(txt, &fin, 10);
+        if (fin == txt || errno == ERANGE || x[k] < INT_MIN || x[k] > INT_MAX) return -1;
+        txt = fin;
+    }
+    while (*txt == ' ' || *txt == '\t' || *txt == '\r') txt++;
+    return (*txt == '\0' || *txt == '#') ? 0 : -1;
+}
+
+// Texto: una pasada en serie parte las líneas y anota dónde empieza cada
+// vehículo y semáforo; después se leen en paralelo directo a su índice.
+static int cargar_escenario_texto(Escenario *e, const char *ruta) {
+    FILE *f = fopen(ruta, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long bytes = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *txt = (bytes >= 0) ? (char*)malloc((size_t)bytes + 1) : NULL;
+    if (!txt || fread(txt, 1, (size_t)bytes, f) != (size_t)bytes) {
+        fclose(f);
+        free(txt);
+        return -1;
+    }
+    fclose(f);
+    txt[bytes] = '\0';
+
+    size_t *lin_veh = NULL, *lin_sem = NULL;
+    int n_veh = 0, n_sem = 0, cap_veh = 0, cap_sem = 0, largo = 0, error = 0, n_linea = 0;
+    for (char *p = txt; *p && !error; ) {
+        char *fin = strchr(p, '\n');
+        if (fin) *fin = '\0';
+        n_linea++;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncmp(p, "vehiculo", 8) == 0) {
+            error = agregar_linea(&lin_veh, &n_veh, &cap_veh, (size_t)(p + 8 - txt));
+        } else if (strncmp(p, "semaforo", 8) == 0) {
+            error = agregar_linea(&lin_sem, &n_sem, &cap_sem, (size_t)(p + 8 - txt));
+        } else if (strncmp(p, "largo", 5) == 0) {
+            long x;
+            error = leer_enteros(p + 5, &x, 1) != 0 || x <= 2 || x > INT_MAX;
+            largo = (int)x;
+        } else if (*p != '\0' && *p != '#' && *p != '\r') {
+            error = 1;
+        }
+        if (error) fprintf(stderr, "%s:%d: linea invalida\n", ruta, n_linea);
+        p = fin ? fin + 1 : p + strlen(p);
+    }
+    if (!error && largo == 0) {
+        fprintf(stderr, "%s: falta la linea largo\n", ruta);
+        error = 1;
+    }
+    e->veh = error ? NULL : (Vehiculo*)malloc(sizeof(Vehiculo) * (n_veh > 0 ? n_veh : 1));
+    e->sem = error ? NULL : (Semaforo*)malloc(sizeof(Semaforo) * (n_sem > 0 ? n_sem : 1));
+    if (!e->veh || !e->sem) error = 1;
+
+    int malos = 0;
+    if (!error) {
+        e->n_veh = n_veh;
+        e->n_sem = n_sem;
+        e->largo = largo;
+        #pragma omp parallel for schedule(static) reduction(+:malos)
+        for (int i = 0; i < n_veh; i++) {
+            long x[2] = { 0, 0 };
+            malos += leer_enteros(txt + lin_veh[i], x, 2) != 0;
+            e->veh[i].id = i;
+            e->veh[i].pos = (int)x[0];
+            e->veh[i].vel_max = (int)x[1];
+        }
+        #pragma omp parallel for schedule(static) reduction(+:malos)
+        for (int j = 0; j < n_sem; j++) {
+            long x[5] = { 0, 0, 0, 0, 0 };
+            malos += leer_enteros(txt + lin_sem[j], x, 5) != 0;
+            Semaforo *sm = &e->sem[j];
+            sm->id = j;
+            sm->pos = (int)x[0];
+            sm->dur_verde = (int)x[1];
+            sm->dur_amarillo = (int)x[2];
+            sm->dur_rojo = (int)x[3];
+            // En long long: la suma de tres duraciones válidas puede no entrar en int
+            long long ciclo = (long long)x[1] + x[2] + x[3];
+            if (ciclo > INT_MAX) {
+                malos++;
+                continue;
+            }
+            poner_fase_semaforo(sm, (ciclo > 0) ? mod_pos((int)(x[4] % ciclo), (int)ciclo) : 0);
+        }
+        if (malos > 0) fprintf(stderr, "%s: %d lineas de vehiculo o semaforo invalidas\n", ruta, malos);
+    }
+    free(txt);
+    free(lin_veh);
+    free(lin_sem);
+    if (error || malos > 0) {
+        free(e->veh);
+        free(e->sem);
+        e->veh = NULL;
+        e->sem = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Binario (magic "TRES") o texto; 0 si quedó cargado y válido
+int trafico_cargar_escenario(Escenario *e, const char *ruta) {
+    memset(e, 0, sizeof(*e));
+    ArchivoMapeado m;
+    if (trafico_mapear_archivo(&m, ruta) == 0) {
+        if (m.bytes >= 4 && memcmp(m.base, ESTADO_MAGIC_ESCENARIO, 4) == 0) {
+            const CabeceraEstado *c = trafico_validar_archivo_estado(&m, ESTADO_MAGIC_ESCENARIO);
+            if (!c) {
+                fprintf(stderr, "%s: escenario binario de otra version o plataforma, truncado o fuera de rango\n", ruta);
+                trafico_desmapear_archivo(&m);
+                return -1;
+            }
+            e->mapa = m;
+            e->veh = (Vehiculo*)(m.base + c->off_vehiculos);
+            e->sem = (Semaforo*)(m.base + c->off_semaforos);
+            e->n_veh = (int)c->n_veh;
+            e->n_sem = (int)c->n_sem;
+            e->largo = (int)c->largo;
+        } else {
+            trafico_desmapear_archivo(&m);
+        }
+    }
+    if (e->mapa.base) return 0;     // validado con la cabecera
+    if (cargar_escenario_texto(e, ruta) != 0) return -1;
+    long long malos = validar_escenario(e);
+    if (malos > 0) {
+        fprintf(stderr, "%s: %lld vehiculos o semaforos fuera de rango\n", ruta, malos);
+        trafico_liberar_escenario(e);
+        return -1;
+    }
+    return 0;
+}
+
+int trafico_escribir_escenario_texto(const char *ruta, const char *titulo, int road_len, const Semaforo *s, int n_sem,
+                                     const VehiculosSoA *v) {
+    FILE *f = fopen(ruta, "w");
+    if (!f) return -1;
+    fprintf(f, "# %s\n", titulo);
+    fprintf(f, "largo %d\n", road_len);
+    for (int j = 0; j < n_sem; j++) {
+        fprintf(f, "semaforo %d %d %d %d %d\n", s[j].pos, s[j].dur_verde, s[j].dur_amarillo, s[j].dur_rojo,
+                fase_de_semaforo(&s[j]));
+    }
+    for (int i = 0; i < v->n; i++) {
+        fprintf(f, "vehiculo %d %d\n", v->pos[i], v->vel_max[i]);
+    }
+    return (fclose(f) == 0) ? 0 : -1;
+}
+// -------------------- Motor por eventos --------------------
+// Los vehículos no interactúan entre sí y los semáforos están en forma cerrada,
+// así que cada vehículo puede avanzar por su cuenta hasta el próximo tick que
+// hay que emitir. Sus únicos eventos son acercarse a una celda con semáforo
+// (hasta ahí avanza vel_max por tick, en un solo salto modular) y quedar
+// frenado ante un semáforo no VERDE (espera hasta que vuelva a VERDE, también
+// en un salto). Entre eventos no se toca memoria ni se miran semáforos.
+// La salida en los ticks emitidos es idéntica a la del motor paso a paso.
+
+static int comparar_int(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Avanza un vehículo desde el tick t (ticks ya completos) hasta fin.
+// celdas: posiciones con semáforo, ordenadas y sin repetir.
+static inline int avanzar_vehiculo(int p, int vel, long long t, long long fin,
+                                   const int *celdas, int n_celdas,
+                                   const TablaCiclos *tabla, const int *celda_sem, int road_len) {
+    while (t < fin) {
+        // Distancia a la próxima celda con semáforo, estrictamente por delante
+        int dist = road_len;
+        if (n_celdas > 0) {
+            int lo = 0, hi = n_celdas;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (celdas[mid] <= p) lo = mid + 1; else hi = mid;
+            }
+            dist = (lo < n_celdas) ? celdas[lo] - p : celdas[0] + road_len - p;
+        }
+        if (dist > vel) {
+            // Hasta dist - 1 celdas no puede caer en ningún semáforo
+            long long libres = (dist - 1) / vel;
+            if (n_celdas == 0 || libres > fin - t) libres = fin - t;
+            p = (int)(((long long)p + libres * vel) % road_len);
+            t += libres;
+            continue;
+        }
+        // Semáforo al alcance: un tick normal, con el estado tras t + 1 actualizaciones
+        int destino = mod_pos_paso(p + vel, road_len);
+        int j = celda_sem[destino];
+        if (j >= 0) {
+            const CicloSemaforo *c = &tabla->ciclos[tabla->fase[j].ciclo];
+            int f = (tabla->fase[j].fase0 + (int)((t + 1) % c->largo)) % c->largo;
+            if (f >= c->dur_verde) {
+                // AMARILLO o ROJO hasta el fin del ciclo: queda quieto todos esos ticks
+                long long espera = c->largo - f;
+                t += (espera < fin - t) ? espera : fin - t;
+                continue;
+            }
+        }
+        p = destino;
+        t++;
+    }
+    return p;
+}
+
+void trafico_simular_eventos(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, Salida *out, Metricas *met) {
+    TablaCiclos tabla;
+    unsigned char *estado = (unsigned char*)malloc(n_sem > 0 ? n_sem : 1);
+    int *celdas = (int*)malloc(sizeof(int) * (n_sem > 0 ? n_sem : 1));
+    if (!estado || !celdas || crear_tabla_ciclos(&tabla, s, n_sem) != 0) {
+        fprintf(stderr, "Sin memoria para el motor por eventos\n");
+        free(estado); free(celdas);
+        return;
+    }
+    int n_celdas = 0;
+    for (int j = 0; j < n_sem; j++) celdas[n_celdas++] = s[j].pos;
+    qsort(celdas, n_celdas, sizeof(int), comparar_int);
+    int u = 0;
+    for (int d = 0; d < n_celdas; d++) {
+        if (u == 0 || celdas[d] != celdas[u - 1]) celdas[u++] = celdas[d];
+    }
+    n_celdas = u;
+
+    int i = 0;  // ticks completos
+    while (i < iteraciones) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        int fin = proximo_emitido(out, i) + 1;
+
+        // El trabajo por vehículo depende de cuántos semáforos cruza: reparto dinámico
+        #pragma omp parallel for schedule(dynamic, VEH_SOA_BLOQUE)
+        for (int q = 0; q < v->n; q++) {
+            v->pos[q] = avanzar_vehiculo(v->pos[q], v->vel_max[q], i, fin,
+                                         celdas, n_celdas, &tabla, celda_sem, road_len);
+        }
+        int primero = i;
+        i = fin;
+        medir_fase(met, primero, FASE_MOVIMIENTO, &marca);
+
+        if (toca_emitir(out, i - 1)) {
+            estados_en_tick(&tabla, i, estado);
+            trafico_emitir_estado(out, v->pos, 1, v->n, estado, n_sem, i - 1);
+        }
+        medir_fase(met, primero, FASE_SALIDA, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, primero, FASE_DELAY, &marca);
+        sumar_fase(met, primero, FASE_TICK, marca - inicio);
+    }
+    sincronizar_semaforos(&tabla, s, iteraciones);
+    liberar_tabla_ciclos(&tabla);
+    free(estado);
+    free(celdas);
+}
+// -------------------- Motor con exclusión (Nagel–Schreckenberg) --------------------
+// Una celda admite a lo sumo un vehículo. El paso de cada vehículo es
+// min(vel_max, hueco al de adelante) y no puede entrar ni cruzar una celda con
+// semáforo no VERDE. Con frenado > 0, un paso posible se reduce en 1 con esa
+// probabilidad (Philox con contador (vehículo, tick + 1), independiente de los hilos).
+// Como nadie adelanta, el orden cíclico en el anillo se conserva: si los vehículos
+// arrancan ordenados por posición, el de adelante de i es siempre i + 1 (mod n).
+// La actualización es simultánea: todos leen pos y escriben pos_sig, así que el
+// resultado no depende del reparto entre hilos y nunca hay dos en la misma celda.
+
+// Exige posiciones distintas y crecientes con el índice (trafico_inicializar_vehiculos
+// las genera así cuando n <= largo; los escenarios se comprueban con
+// trafico_posiciones_crecientes).
+int trafico_posiciones_crecientes(const Vehiculo *v, int n) {
+    int malos = 0;
+    #pragma omp parallel for schedule(static) reduction(+:malos)
+    for (int i = 0; i < n - 1; i++) {
+        malos += (v[i + 1].pos <= v[i].pos);
+    }
+    return malos == 0;
+}
+
+static void mover_vehiculos_exclusion(const int *restrict pos, int *restrict pos_sig, const int *restrict vel, int n,
+                                      const int *estado_celda, int road_len, uint32_t umbral_frenado, uint32_t semilla, int tick) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        int p = pos[i];
+        int adelante = (i + 1 < n) ? pos[i + 1] : pos[0];
+        int hueco = (n > 1) ? mod_pos_paso(adelante - p - 1 + road_len, road_len) : road_len - 1;
+        int paso = (vel[i] < hueco) ? vel[i] : hueco;
+        for (int d = 1; d <= paso; d++) {
+            if (estado_celda[mod_pos_paso(p + d, road_len)] != VERDE) {
+                paso = d - 1;
+                break;
+            }
+        }
+        if (umbral_frenado > 0 && paso > 0) {
+            uint32_t r[2];
+            philox2x32((uint32_t)i, (uint32_t)tick + 1u, semilla, r);
+            if (r[0] < umbral_frenado) paso--;
+        }
+        pos_sig[i] = mod_pos_paso(p + paso, road_len);
+    }
+}
+
+// Probabilidad de frenado como umbral sobre un u32
+static uint32_t umbral_frenado(double frenado) {
+    if (frenado >= 1.0) return UINT32_MAX;
+    if (frenado > 0.0) return (uint32_t)(frenado * 4294967296.0);
+    return 0;
+}
+
+void trafico_simular_exclusion(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg,
+                               double frenado, unsigned int seed, Salida *out, Metricas *met) {
+    int *estado_celda = (int*)alloc_alineado(sizeof(int) * road_len);
+    int *pos_sig = (int*)alloc_alineado(sizeof(int) * v->n_pad);
+    EstadoSemaforos est;
+    if (!estado_celda || !pos_sig || crear_estado_semaforos(&est, s, n_sem) != 0) {
+        fprintf(stderr, "Sin memoria para el motor con exclusion\n");
+        liberar_alineado(estado_celda);
+        liberar_alineado(pos_sig);
+        return;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < road_len; c++) {
+        estado_celda[c] = VERDE;
+    }
+    uint32_t umbral = umbral_frenado(frenado);
+
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        actualizar_semaforos(s, n_sem, estado_siguiente(&est));
+        medir_fase(met, i, FASE_SEMAFOROS, &marca);
+        intercambiar_estado(&est);
+        publicar_estado_celdas(s, estado_actual(&est), n_sem, celda_sem, estado_celda);
+        medir_fase(met, i, FASE_SNAPSHOT, &marca);
+
+        mover_vehiculos_exclusion(v->pos, pos_sig, v->vel_max, v->n, estado_celda, road_len, umbral, seed, i);
+        int *tmp = v->pos;
+        v->pos = pos_sig;
+        pos_sig = tmp;
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+
+        trafico_emitir_estado(out, v->pos, 1, v->n, estado_actual(&est), n_sem, i);
+        medir_fase(met, i, FASE_SALIDA, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    liberar_estado_semaforos(&est);
+    liberar_alineado(estado_celda);
+    liberar_alineado(pos_sig);
+}
+// -------------------- Carriles múltiples --------------------
+// El modelo con exclusión sobre K carriles del mismo largo; cada semáforo corta
+// todos los carriles de su celda. La ocupación es una grilla de K * largo bytes
+// (carril * largo + celda). Cada tick, después de los semáforos:
+//   1. Cambio de carril. Un vehículo frenado por otro dentro de su vel_max mira
+//      el carril vecino (el de menor índice en ticks pares, el de mayor en
+//      impares) y se pasa si están libres su celda, las vel_max siguientes y las
+//      vmax anteriores. Como todos cambian hacia el mismo lado, cada celda
+//      destino tiene un solo candidato: se decide sobre la grilla al inicio de
+//      la fase y se aplica en paralelo sin conflictos ni dependencia de hilos.
+//   2. Avance, como en mover_vehiculos_exclusion pero mirando la grilla del
+//      propio carril. Cada destino queda entre el vehículo y la siguiente celda
+//      ocupada, así que los destinos son disjuntos y la grilla se actualiza en
+//      paralelo.
+// Con un solo carril da lo mismo que trafico_simular_exclusion.
+
+static inline uint8_t *celda_carril(uint8_t *ocup, int carril, int c, int road_len) {
+    return &ocup[(size_t)carril * road_len + c];
+}
+
+// v trae posiciones sobre un anillo virtual de carriles * largo celdas (las de
+// trafico_inicializar_vehiculos con ese largo): la celda virtual p es el carril
+// p % carriles en la posición p / carriles, así que no hay dos en la misma celda.
+// La salida da cada vehículo como carril * largo + posición (una trayectoria de
+// carriles * largo celdas). Devuelve los cambios de carril de toda la corrida
+// (-1 sin memoria).
+long long trafico_simular_carriles(int iteraciones, const Vehiculo *v, int n_veh, int carriles, Semaforo *s, int n_sem, const int *celda_sem,
+                                   int road_len, int delay_seg, double frenado, unsigned int seed, Salida *out, Metricas *met) {
+    int *pos = (int*)malloc(sizeof(int) * n_veh);
+    int *carril = (int*)malloc(sizeof(int) * n_veh);
+    int *vel = (int*)malloc(sizeof(int) * n_veh);
+    int *sig = (int*)malloc(sizeof(int) * n_veh);  // carril o posición decididos en cada fase
+    int *pos_salida = (int*)malloc(sizeof(int) * n_veh);
+    uint8_t *ocup = (uint8_t*)calloc((size_t)carriles * road_len, 1);
+    int *estado_celda = (int*)malloc(sizeof(int) * road_len);
+    EstadoSemaforos est;
+    if (!pos || !carril || !vel || !sig || !pos_salida || !ocup || !estado_celda || crear_estado_semaforos(&est, s, n_sem) != 0) {
+        fprintf(stderr, "Sin memoria para %d carriles\n", carriles);
+        free(pos); free(carril); free(vel); free(sig); free(pos_salida); free(ocup); free(estado_celda);
+        return -1;
+    }
+    int vmax = 1;
+    for (int q = 0; q < n_veh; q++) {
+        pos[q] = v[q].pos / carriles;
+        carril[q] = v[q].pos % carriles;
+        vel[q] = v[q].vel_max;
+        if (vel[q] > vmax) vmax = vel[q];
+        *celda_carril(ocup, carril[q], pos[q], road_len) = 1;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < road_len; c++) {
+        estado_celda[c] = VERDE;
+    }
+    uint32_t umbral = umbral_frenado(frenado);
+    long long cambios = 0;
+
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        actualizar_semaforos(s, n_sem, estado_siguiente(&est));
+        medir_fase(met, i, FASE_SEMAFOROS, &marca);
+        intercambiar_estado(&est);
+        publicar_estado_celdas(s, estado_actual(&est), n_sem, celda_sem, estado_celda);
+        medir_fase(met, i, FASE_SNAPSHOT, &marca);
+
+        // 1. Cambio de carril: decidir sobre la grilla sin tocarla, luego aplicar
+        int dir = (i % 2 == 0) ? -1 : 1;
+        #pragma omp parallel for schedule(static) reduction(+:cambios)
+        for (int q = 0; q < n_veh; q++) {
+            int l = carril[q], p = pos[q], t = l + dir;
+            sig[q] = l;
+            if (t < 0 || t >= carriles) continue;
+            int frenado_por_otro = 0;
+            for (int d = 1; d <= vel[q] && !frenado_por_otro; d++) {
+                frenado_por_otro = *celda_carril(ocup, l, mod_pos_paso(p + d, road_len), road_len);
+            }
+            if (!frenado_por_otro || *celda_carril(ocup, t, p, road_len)) continue;
+            int libre = 1;
+            for (int d = 1; d <= vel[q] && libre; d++) {
+                libre = !*celda_carril(ocup, t, mod_pos_paso(p + d, road_len), road_len);
+            }
+            for (int d = 1; d <= vmax && libre; d++) {
+                libre = !*celda_carril(ocup, t, mod_pos(p - d, road_len), road_len);
+            }
+            if (libre) {
+                sig[q] = t;
+                cambios++;
+            }
+        }
+        #pragma omp parallel for schedule(static)
+        for (int q = 0; q < n_veh; q++) {
+            if (sig[q] == carril[q]) continue;
+            *celda_carril(ocup, carril[q], pos[q], road_len) = 0;
+            *celda_carril(ocup, sig[q], pos[q], road_len) = 1;
+            carril[q] = sig[q];
+        }
+
+        // 2. Avance dentro de cada carril
+        #pragma omp parallel for schedule(static)
+        for (int q = 0; q < n_veh; q++) {
+            int p = pos[q], paso = 0;
+            for (int d = 1; d <= vel[q]; d++) {
+                int c = mod_pos_paso(p + d, road_len);
+                if (*celda_carril(ocup, carril[q], c, road_len) || estado_celda[c] != VERDE) break;
+                paso = d;
+            }
+            if (umbral > 0 && paso > 0) {
+                uint32_t r[2];
+                philox2x32((uint32_t)q, (uint32_t)i + 1u, seed, r);
+                if (r[0] < umbral) paso--;
+            }
+            sig[q] = mod_pos_paso(p + paso, road_len);
+        }
+        #pragma omp parallel for schedule(static)
+        for (int q = 0; q < n_veh; q++) {
+            if (sig[q] == pos[q]) continue;
+            *celda_carril(ocup, carril[q], pos[q], road_len) = 0;
+            *celda_carril(ocup, carril[q], sig[q], road_len) = 1;
+            pos[q] = sig[q];
+        }
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+
+        if (toca_emitir(out, i)) {
+            #pragma omp parallel for schedule(static)
+            for (int q = 0; q < n_veh; q++) {
+                pos_salida[q] = carril[q] * road_len + pos[q];
+            }
+            trafico_emitir_estado(out, pos_salida, 1, n_veh, estado_actual(&est), n_sem, i);
+        }
+        medir_fase(met, i, FASE_SALIDA, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    liberar_estado_semaforos(&est);
+    free(pos); free(carril); free(vel); free(sig); free(pos_salida); free(ocup); free(estado_celda);
+    return cambios;
+}
+// -------------------- Red de calles --------------------
+// Cada Interseccion describe un tramo de calle dirigido (su largo, sus vehículos
+// y sus semáforos) y la red los une en nodos con un grafo CSR: los tramos que
+// salen del nodo u son col[fila[u] .. fila[u + 1]) y destino[t] es el nodo al
+// que llega el tramo t. Cada tramo tiene un semáforo en su última celda, que
+// es la entrada al nodo.
+//
+// Un vehículo avanza vel_max como en la carretera; si su destino es la celda
+// del semáforo se detiene si no está VERDE, y si la pasa cruza el nodo sólo con
+// VERDE y entra al tramo de salida que sortea Philox con (id, tick + 1), con el
+// sobrante del paso. Los vehículos se guardan agrupados por tramo y
+// tramos[t].vehiculos apunta a su grupo; tras mover se reagrupan con un
+// counting sort paralelo y estable. Cada hilo recibe un rango contiguo de
+// tramos con la misma cantidad de vehículos, así que el trabajo queda parejo
+// aunque los tramos estén muy desparejos.
+void trafico_liberar_red(Red *r) {
+    free(r->fila); free(r->col); free(r->destino); free(r->base); free(r->tramos); free(r->sem);
+    free(r->veh); free(r->veh_sig); free(r->tramo_sig); free(r->inicio); free(r->cuenta);
+    memset(r, 0, sizeof(*r));
+}
+
+// Apunta cada tramo a su grupo de vehículos en veh
+static void enlazar_tramos(Red *r) {
+    for (int t = 0; t < r->n_tramos; t++) {
+        r->tramos[t].vehiculos = r->veh + r->inicio[t];
+        r->tramos[t].n_veh = r->inicio[t + 1] - r->inicio[t];
+    }
+}
+
+// Ciudad en grilla de filas x cols nodos sobre un toro: cada nodo tiene tramos
+// de largo celdas hacia el este, el sur, el oeste y el norte. Los semáforos
+// toman las duraciones de modelo; los de los tramos horizontales arrancan en
+// VERDE y los de los verticales en ROJO. El vehículo i arranca en el tramo
+// i % n_tramos en una celda sorteada.
+int trafico_crear_red_grilla(Red *r, int filas, int cols, int largo, int n_veh, const Semaforo *modelo, unsigned int seed) {
+    memset(r, 0, sizeof(*r));
+    r->n_nodos = filas * cols;
+    r->n_tramos = 4 * r->n_nodos;
+    r->n_veh = n_veh;
+    r->hilos = omp_get_max_threads();
+    int nt = r->n_tramos;
+    r->fila = (int*)malloc(sizeof(int) * (r->n_nodos + 1));
+    r->col = (int*)malloc(sizeof(int) * nt);
+    r->destino = (int*)malloc(sizeof(int) * nt);
+    r->base = (int*)malloc(sizeof(int) * (nt + 1));
+    r->tramos = (Interseccion*)calloc(nt, sizeof(Interseccion));
+    r->sem = (Semaforo*)malloc(sizeof(Semaforo) * nt);
+    r->veh = (Vehiculo*)malloc(sizeof(Vehiculo) * n_veh);
+    r->veh_sig = (Vehiculo*)malloc(sizeof(Vehiculo) * n_veh);
+    r->tramo_sig = (int*)malloc(sizeof(int) * n_veh);
+    r->inicio = (int*)calloc(nt + 1, sizeof(int));
+    r->cuenta = (int*)malloc(sizeof(int) * (size_t)r->hilos * nt);
+    if (!r->fila || !r->col || !r->destino || !r->base || !r->tramos || !r->sem || !r->veh ||
+        !r->veh_sig || !r->tramo_sig || !r->inicio || !r->cuenta) {
+        trafico_liberar_red(r);
+        return -1;
+    }
+    static const int DF[4] = { 0, 1, 0, -1 }, DC[4] = { 1, 0, -1, 0 };
+    for (int u = 0; u < r->n_nodos; u++) {
+        int f = u / cols, c = u % cols;
+        r->fila[u] = 4 * u;
+        for (int k = 0; k < 4; k++) {
+            int t = 4 * u + k;
+            r->col[t] = t;
+            r->destino[t] = ((f + DF[k] + filas) % filas) * cols + (c + DC[k] + cols) % cols;
+        }
+    }
+    r->fila[r->n_nodos] = nt;
+    for (int t = 0; t < nt; t++) {
+        Semaforo *sm = &r->sem[t];
+        *sm = *modelo;
+        sm->id = t;
+        sm->pos = largo - 1;
+        sm->estado = (t % 2 == 0) ? VERDE : ROJO;   // este/oeste en VERDE, sur/norte en ROJO
+        sm->t_en_estado = 0;
+        r->tramos[t].largo = largo;
+        r->tramos[t].semaforos = sm;
+        r->tramos[t].n_sem = 1;
+        r->base[t] = t * largo;
+    }
+    r->base[nt] = nt * largo;
+
+    // Vehículos ya agrupados: el tramo t tiene los i con i % nt == t
+    for (int t = 0; t < nt; t++) r->inicio[t + 1] = r->inicio[t] + (n_veh - t + nt - 1) / nt;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n_veh; i++) {
+        uint32_t a[2];
+        philox2x32((uint32_t)i, 0u, seed, a);
+        Vehiculo *v = &r->veh[r->inicio[i % nt] + i / nt];
+        v->id = i;
+        v->pos = (int)(a[0] % (uint32_t)largo);
+        v->vel_max = 1 + (int)(a[1] & 1u);
+    }
+    enlazar_tramos(r);
+    return 0;
+}
+
+// Tramo del vehículo q (el último t con inicio[t] <= q)
+static int tramo_de_vehiculo(const Red *r, int q) {
+    int lo = 0, hi = r->n_tramos;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (r->inicio[mid] <= q) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+static void mover_red(Red *r, int tick, unsigned int seed) {
+    #pragma omp parallel
+    {
+        int h = omp_get_thread_num(), nh = omp_get_num_threads();
+        int q0 = (int)((long long)r->n_veh * h / nh), q1 = (int)((long long)r->n_veh * (h + 1) / nh);
+        int t = (q0 < q1) ? tramo_de_vehiculo(r, q0) : 0;
+        for (int q = q0; q < q1; q++) {
+            while (r->inicio[t + 1] <= q) t++;
+            const Interseccion *tr = &r->tramos[t];
+            Vehiculo *v = &r->veh[q];
+            int luz = tr->largo - 1;
+            int destino = v->pos + v->vel_max;
+            int verde = (tr->semaforos[0].estado == VERDE);
+            r->tramo_sig[q] = t;
+            if (destino < luz || (destino == luz && verde)) {
+                v->pos = destino;
+            } else if (destino > luz && verde) {
+                int u = r->destino[t];
+                int grado = r->fila[u + 1] - r->fila[u];
+                uint32_t a[2];
+                philox2x32((uint32_t)v->id, (uint32_t)tick + 1u, seed, a);
+                r->tramo_sig[q] = r->col[r->fila[u] + (int)(a[0] % (uint32_t)grado)];
+                v->pos = destino - tr->largo;
+            }
+            // si no, frenado ante el semáforo
+        }
+    }
+}
+
+// Counting sort estable de veh por tramo_sig (mismos tramos de vehículos por
+// hilo en el conteo y en el reparto); deja veh agrupado y los tramos enlazados.
+static void reagrupar_red(Red *r) {
+    int nt = r->n_tramos;
+    #pragma omp parallel num_threads(r->hilos)
+    {
+        int h = omp_get_thread_num(), nh = omp_get_num_threads();
+        int q0 = (int)((long long)r->n_veh * h / nh), q1 = (int)((long long)r->n_veh * (h + 1) / nh);
+        int *cnt = r->cuenta + (size_t)h * nt;
+        memset(cnt, 0, sizeof(int) * nt);
+        for (int q = q0; q < q1; q++) cnt[r->tramo_sig[q]]++;
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int acum = 0;
+            for (int t = 0; t < nt; t++) {
+                r->inicio[t] = acum;
+                for (int k = 0; k < nh; k++) {
+                    int c = r->cuenta[(size_t)k * nt + t];
+                    r->cuenta[(size_t)k * nt + t] = acum;
+                    acum += c;
+                }
+            }
+            r->inicio[nt] = acum;
+        }
+        for (int q = q0; q < q1; q++) r->veh_sig[cnt[r->tramo_sig[q]]++] = r->veh[q];
+    }
+    Vehiculo *tmp = r->veh;
+    r->veh = r->veh_sig;
+    r->veh_sig = tmp;
+    enlazar_tramos(r);
+}
+
+// La salida numera las celdas de todos los tramos seguidas (base[t] + pos) y
+// tiene un semáforo por tramo. 0 si corrió; -1 sin memoria para la salida.
+int trafico_simular_red(int iteraciones, Red *r, unsigned int seed, int delay_seg, Salida *out, Metricas *met) {
+    int *pos_por_id = (int*)malloc(sizeof(int) * (r->n_veh > 0 ? r->n_veh : 1));
+    unsigned char *estado = (unsigned char*)malloc(r->n_tramos);
+    if (!pos_por_id || !estado) {
+        fprintf(stderr, "Sin memoria para la salida de la red\n");
+        free(pos_por_id); free(estado);
+        return -1;
+    }
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        #pragma omp parallel for schedule(static)
+        for (int t = 0; t < r->n_tramos; t++) {
+            Interseccion *tr = &r->tramos[t];
+            for (int k = 0; k < tr->n_sem; k++) avanzar_semaforo(&tr->semaforos[k]);
+            estado[t] = (unsigned char)tr->semaforos[0].estado;
+        }
+        medir_fase(met, i, FASE_SEMAFOROS, &marca);
+
+        mover_red(r, i, seed);
+        reagrupar_red(r);
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+
+        if (toca_emitir(out, i)) {
+            #pragma omp parallel for schedule(static)
+            for (int t = 0; t < r->n_tramos; t++) {
+                const Interseccion *tr = &r->tramos[t];
+                for (int k = 0; k < tr->n_veh; k++) {
+                    pos_por_id[tr->vehiculos[k].id] = r->base[t] + tr->vehiculos[k].pos;
+                }
+            }
+            trafico_emitir_estado(out, pos_por_id, 1, r->n_veh, estado, r->n_tramos, i);
+        }
+        medir_fase(met, i, FASE_SALIDA, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    free(pos_por_id);
+    free(estado);
+    return 0;
+}
+// -------------------- Descomposición por dominios --------------------
+// El anillo se parte en tramos contiguos [ini, fin), uno por hilo. Cada tramo es
+// dueño de sus semáforos, de sus celdas de estado_celda y de los vehículos que
+// están en él. Como ningún tramo es más corto que la velocidad máxima, un
+// vehículo sólo puede pasar al tramo siguiente: lo deja en el buffer de traspaso
+// de su tramo y el dueño del siguiente lo recoge tras la barrera. Lo único que
+// un tramo lee de otro son las primeras vel_max celdas de estado_celda del
+// siguiente y su buffer de traspaso: un halo y un mensaje por frontera si los
+// tramos se reparten entre procesos.
+typedef struct {
+    int ini, fin;           // celdas del tramo
+    int *pos, *vel, *id;    // vehículos del tramo, sin orden
+    int n, cap;
+    int *sem;               // índices de los semáforos del tramo
+    int n_sem;
+    int *t_pos, *t_vel, *t_id;  // traspaso hacia el tramo siguiente
+    int t_n, t_cap;
+} Dominio;
+
+static int tramo_de(const Dominio *d, int n_dom, int road_len, int pos) {
+    int t = (int)((long long)pos * n_dom / road_len);
+    while (t > 0 && pos < d[t].ini) t--;
+    while (t < n_dom - 1 && pos >= d[t].fin) t++;
+    return t;
+}
+
+// Asegura lugar para al menos minimo vehículos (en el tramo o en su traspaso)
+static int crecer_vehiculos(int **pos, int **vel, int **id, int *cap, int minimo) {
+    if (minimo <= *cap) return 0;
+    int nuevo = (*cap > 0) ? *cap : 64;
+    while (nuevo < minimo) nuevo *= 2;
+    int *p = (int*)realloc(*pos, sizeof(int) * nuevo);
+    if (p) *pos = p;
+    int *v = (int*)realloc(*vel, sizeof(int) * nuevo);
+    if (v) *vel = v;
+    int *i = (int*)realloc(*id, sizeof(int) * nuevo);
+    if (i) *id = i;
+    if (!p || !v || !i) return -1;
+    *cap = nuevo;
+    return 0;
+}
+
+static void liberar_dominios(Dominio *d, int n_dom) {
+    for (int t = 0; t < n_dom; t++) {
+        free(d[t].pos); free(d[t].vel); free(d[t].id); free(d[t].sem);
+        free(d[t].t_pos); free(d[t].t_vel); free(d[t].t_id);
+    }
+    free(d);
+}
+
+// n_dom se acota para que ningún tramo sea más corto que la velocidad máxima
+static Dominio *crear_dominios(int *n_dom, const Vehiculo *v, int n_veh, const Semaforo *s, int n_sem, int road_len) {
+    int vmax = 1;
+    for (int i = 0; i < n_veh; i++) {
+        if (v[i].vel_max > vmax) vmax = v[i].vel_max;
+    }
+    int n = omp_get_max_threads();
+    if (n > road_len / vmax) n = road_len / vmax;
+    if (n < 1) n = 1;
+    Dominio *d = (Dominio*)calloc(n, sizeof(Dominio));
+    if (!d) return NULL;
+    for (int t = 0; t < n; t++) {
+        d[t].ini = (int)((long long)road_len * t / n);
+        d[t].fin = (int)((long long)road_len * (t + 1) / n);
+    }
+    int fallo = 0;
+    for (int j = 0; j < n_sem; j++) d[tramo_de(d, n, road_len, s[j].pos)].n_sem++;
+    for (int i = 0; i < n_veh; i++) d[tramo_de(d, n, road_len, v[i].pos)].n++;
+    for (int t = 0; t < n; t++) {
+        d[t].sem = (int*)malloc(sizeof(int) * (d[t].n_sem > 0 ? d[t].n_sem : 1));
+        if (!d[t].sem) fallo = 1;
+        fallo |= crecer_vehiculos(&d[t].pos, &d[t].vel, &d[t].id, &d[t].cap, 2 * d[t].n + 64);
+        fallo |= crecer_vehiculos(&d[t].t_pos, &d[t].t_vel, &d[t].t_id, &d[t].t_cap, d[t].cap);
+        d[t].n_sem = d[t].n = 0;
+    }
+    if (fallo) {
+        liberar_dominios(d, n);
+        return NULL;
+    }
+    for (int j = 0; j < n_sem; j++) {
+        Dominio *t = &d[tramo_de(d, n, road_len, s[j].pos)];
+        t->sem[t->n_sem++] = j;
+    }
+    for (int i = 0; i < n_veh; i++) {
+        Dominio *t = &d[tramo_de(d, n, road_len, v[i].pos)];
+        t->pos[t->n] = v[i].pos;
+        t->vel[t->n] = v[i].vel_max;
+        t->id[t->n] = v[i].id;
+        t->n++;
+    }
+    *n_dom = n;
+    return d;
+}
+
+// Mismo modelo y salida que trafico_simular_simple. Un tick por hilo y tramo:
+// semáforos propios, barrera, mover (los que salen van al traspaso), barrera,
+// recoger el traspaso del tramo anterior. Los tramos se reparten round-robin
+// por si el equipo resulta más chico que n_dom.
+void trafico_simular_dominios(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, Salida *out, Metricas *met) {
+    int n_dom = 0;
+    Dominio *d = crear_dominios(&n_dom, v, n_veh, s, n_sem, road_len);
+    int *estado_celda = (int*)malloc(sizeof(int) * road_len);
+    unsigned char *estado = (unsigned char*)malloc(n_sem);
+    int *pos_por_id = (int*)malloc(sizeof(int) * n_veh);
+    if (!d || !estado_celda || !estado || !pos_por_id) {
+        fprintf(stderr, "Sin memoria para los dominios\n");
+        if (d) liberar_dominios(d, n_dom);
+        free(estado_celda); free(estado); free(pos_por_id);
+        return;
+    }
+    int fallo = 0;
+
+    #pragma omp parallel num_threads(n_dom)
+    {
+        int h = omp_get_thread_num(), nh = omp_get_num_threads();
+        int mide = (met != NULL && h == 0);
+        // Primer toque: cada hilo inicializa las celdas de sus tramos
+        for (int t = h; t < n_dom; t += nh) {
+            for (int c = d[t].ini; c < d[t].fin; c++) estado_celda[c] = VERDE;
+        }
+        #pragma omp barrier
+
+        for (int i = 0; i < iteraciones; i++) {
+            double inicio = 0.0, marca = 0.0;
+            if (mide) inicio = marca = omp_get_wtime();
+            for (int t = h; t < n_dom; t += nh) {
+                for (int q = 0; q < d[t].n_sem; q++) {
+                    int j = d[t].sem[q];
+                    avanzar_semaforo(&s[j]);
+                    estado[j] = (unsigned char)s[j].estado;
+                    if (celda_sem[s[j].pos] == j) estado_celda[s[j].pos] = s[j].estado;
+                }
+            }
+            #pragma omp barrier
+            if (mide) medir_fase(met, i, FASE_SEMAFOROS, &marca);
+            int f;
+            #pragma omp atomic read
+            f = fallo;
+            if (f) break;
+
+            for (int t = h; t < n_dom; t += nh) {
+                Dominio *dt = &d[t];
+                if (crecer_vehiculos(&dt->t_pos, &dt->t_vel, &dt->t_id, &dt->t_cap, dt->n) != 0) {
+                    #pragma omp atomic write
+                    fallo = 1;
+                    continue;
+                }
+                int quedan = 0, salen = 0;
+                for (int q = 0; q < dt->n; q++) {
+                    int p = dt->pos[q];
+                    int destino = mod_pos_paso(p + dt->vel[q], road_len);
+                    if (estado_celda[destino] == VERDE) p = destino;
+                    if (p >= dt->ini && p < dt->fin) {
+                        dt->pos[quedan] = p;
+                        dt->vel[quedan] = dt->vel[q];
+                        dt->id[quedan] = dt->id[q];
+                        quedan++;
+                    } else {
+                        dt->t_pos[salen] = p;
+                        dt->t_vel[salen] = dt->vel[q];
+                        dt->t_id[salen] = dt->id[q];
+                        salen++;
+                    }
+                }
+                dt->n = quedan;
+                dt->t_n = salen;
+            }
+            #pragma omp barrier
+            for (int t = h; t < n_dom; t += nh) {
+                Dominio *dt = &d[t];
+                const Dominio *ant = &d[(t + n_dom - 1) % n_dom];
+                if (crecer_vehiculos(&dt->pos, &dt->vel, &dt->id, &dt->cap, dt->n + ant->t_n) != 0) {
+                    #pragma omp atomic write
+                    fallo = 1;
+                    continue;
+                }
+                memcpy(dt->pos + dt->n, ant->t_pos, sizeof(int) * ant->t_n);
+                memcpy(dt->vel + dt->n, ant->t_vel, sizeof(int) * ant->t_n);
+                memcpy(dt->id + dt->n, ant->t_id, sizeof(int) * ant->t_n);
+                dt->n += ant->t_n;
+            }
+            // El traspaso de ant no se pisa hasta después de la barrera del próximo tick
+            if (mide) medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+
+            if (toca_emitir(out, i)) {
+                for (int t = h; t < n_dom; t += nh) {
+                    for (int q = 0; q < d[t].n; q++) pos_por_id[d[t].id[q]] = d[t].pos[q];
+                }
+                #pragma omp barrier
+                if (mide) medir_fase(met, i, FASE_SNAPSHOT, &marca);
+                #pragma omp single
+                trafico_emitir_estado(out, pos_por_id, 1, n_veh, estado, n_sem, i);
+                if (mide) medir_fase(met, i, FASE_SALIDA, &marca);
+            }
+            if (delay_seg > 0) {
+                #pragma omp single
+                SLEEP_SEC(delay_seg);
+            }
+            if (mide) {
+                medir_fase(met, i, FASE_DELAY, &marca);
+                sumar_fase(met, i, FASE_TICK, marca - inicio);
+            }
+        }
+    }
+    if (fallo) fprintf(stderr, "Sin memoria para los traspasos entre dominios\n");
+    liberar_dominios(d, n_dom);
+    free(estado_celda);
+    free(estado);
+    free(pos_por_id);
+}
+// -------------------- Codificación compacta --------------------
+// Para escenarios de 1e9 vehículos: ids implícitos (el índice), vel_max en un
+// byte y posiciones en el entero más angosto que cubre [0, largo) (1, 2, 4 u 8
+// bytes). Los semáforos sólo guardan ciclo y fase en la TablaCiclos compartida;
+// el estado por celda va en 2 bits, codificado como estado ^ VERDE para que 0
+// sea "se puede pasar" y las celdas sin semáforo arranquen en cero. Las celdas
+// se leen de a palabras de 32 bits (16 celdas): la lectura indexada de enteros
+// vectoriza, la de bytes no. No se arma Vehiculo[] ni celda_sem: por tick se
+// leen 2 a 5 bytes por vehículo en lugar de 12.
+//
+// Es también el único motor con índices de 64 bits: cantidades, largo y
+// contadores son int64_t en la preparación, y los kernels existen con índice
+// int (el camino rápido por defecto) y con índice int64_t, que sólo se usa si
+// el largo o la cantidad de vehículos no entran en int.
+static inline int bytes_pos_compacto(int64_t largo) {
+    if (largo <= LIMITE_INDICE_32) return tray_bytes_pos((int)largo);
+    return (largo <= ((int64_t)1 << 32)) ? 4 : 8;
+}
+
+// Misma distribución que trafico_inicializar_vehiculos, escrita directo en el formato
+// compacto. El contador de Philox es (i, i >> 32): igual que allí para i < 2^32.
+// Con espacio > 2^32 la palabra alta del jitter sale de una segunda llamada con
+// el bit alto del contador encendido, que no coincide con ningún (i, i >> 32).
+int trafico_crear_vehiculos_compactos(VehiculosCompactos *v, int64_t n, int64_t road_len, unsigned int seed) {
+    v->n = n;
+    v->bytes_pos = bytes_pos_compacto(road_len);
+    v->indices_64 = requiere_indices_64(n, road_len);
+    v->pos = malloc((size_t)n * v->bytes_pos);
+    v->vel_max = (uint8_t*)malloc((size_t)n);
+    if (!v->pos || !v->vel_max) {
+        free(v->pos);
+        free(v->vel_max);
+        return -1;
+    }
+    int64_t espacio = (road_len > n) ? (road_len / n) : 1;
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < n; i++) {
+        uint32_t r[2];
+        philox2x32((uint32_t)i, (uint32_t)(i >> 32), seed, r);
+        int64_t jitter = 0;
+        if (espacio > 1 && espacio <= UINT32_MAX) {
+            jitter = (int64_t)(r[0] % (uint32_t)espacio);
+        } else if (espacio > UINT32_MAX) {
+            uint32_t alto[2];
+            philox2x32((uint32_t)i, (uint32_t)(i >> 32) | 0x80000000u, seed, alto);
+            jitter = (int64_t)((((uint64_t)alto[0] << 32) | r[0]) % (uint64_t)espacio);
+        }
+        uint64_t p = (uint64_t)((i * espacio % road_len + jitter) % road_len);
+        switch (v->bytes_pos) {
+            case 1:  ((uint8_t*)v->pos)[i] = (uint8_t)p;   break;
+            case 2:  ((uint16_t*)v->pos)[i] = (uint16_t)p; break;
+            case 4:  ((uint32_t*)v->pos)[i] = (uint32_t)p; break;
+            default: ((uint64_t*)v->pos)[i] = p;           break;
+        }
+        v->vel_max[i] = (uint8_t)(1 + (r[1] & 1u));
+    }
+    return 0;
+}
+
+void trafico_liberar_vehiculos_compactos(VehiculosCompactos *v) {
+    free(v->pos);
+    free(v->vel_max);
+    v->pos = NULL;
+    v->vel_max = NULL;
+}
+
+// Un kernel por ancho de posición T, tipo de índice I y nivel de ISA: sin
+// AVX2 la lectura indexada de celdas no vectoriza
+#define DEFINIR_MOVER_COMPACTO(T, I, sufijo, ATRIB) \
+ATRIB static void mover_compacto_##sufijo(T *restrict pos, const uint8_t *restrict vel, I n, \
+                                          const uint32_t *restrict celdas, I road_len) { \
+    _Pragma("omp parallel for simd schedule(static)") \
+    for (I i = 0; i < n; i++) { \
+        I destino = (I)pos[i] + vel[i]; \
+        destino -= (destino >= road_len) ? road_len : 0; \
+        uint32_t codigo = (celdas[destino >> 4] >> (2 * (destino & 15))) & 3u; \
+        pos[i] = codigo ? pos[i] : (T)destino; \
+    } \
+}
+#define DEFINIR_MOVER_COMPACTOS(isa, ATRIB) \
+    DEFINIR_MOVER_COMPACTO(uint8_t,  int, u8_##isa, ATRIB) \
+    DEFINIR_MOVER_COMPACTO(uint16_t, int, u16_##isa, ATRIB) \
+    DEFINIR_MOVER_COMPACTO(uint32_t, int, u32_##isa, ATRIB) \
+    DEFINIR_MOVER_COMPACTO(uint8_t,  int64_t, u8_i64_##isa, ATRIB) \
+    DEFINIR_MOVER_COMPACTO(uint16_t, int64_t, u16_i64_##isa, ATRIB) \
+    DEFINIR_MOVER_COMPACTO(uint32_t, int64_t, u32_i64_##isa, ATRIB) \
+    DEFINIR_MOVER_COMPACTO(uint64_t, int64_t, u64_i64_##isa, ATRIB)
+ISA_VARIANTES(DEFINIR_MOVER_COMPACTOS)
+
+#define TABLA_MOVER_COMPACTO(T, I, sufijo) \
+static void (*const MOVER_COMPACTO_##sufijo[N_ISA])(T*, const uint8_t*, I, const uint32_t*, I) = \
+    ISA_TABLA(mover_compacto_##sufijo);
+TABLA_MOVER_COMPACTO(uint8_t,  int, u8)
+TABLA_MOVER_COMPACTO(uint16_t, int, u16)
+TABLA_MOVER_COMPACTO(uint32_t, int, u32)
+TABLA_MOVER_COMPACTO(uint8_t,  int64_t, u8_i64)
+TABLA_MOVER_COMPACTO(uint16_t, int64_t, u16_i64)
+TABLA_MOVER_COMPACTO(uint32_t, int64_t, u32_i64)
+TABLA_MOVER_COMPACTO(uint64_t, int64_t, u64_i64)
+
+static void mover_vehiculos_compactos(VehiculosCompactos *v, const uint32_t *celdas, int64_t road_len) {
+    NivelIsa k = isa_activa;
+    if (!v->indices_64) {
+        int n = (int)v->n, largo = (int)road_len;
+        switch (v->bytes_pos) {
+            case 1:  MOVER_COMPACTO_u8[k]((uint8_t*)v->pos, v->vel_max, n, celdas, largo);   break;
+            case 2:  MOVER_COMPACTO_u16[k]((uint16_t*)v->pos, v->vel_max, n, celdas, largo); break;
+            default: MOVER_COMPACTO_u32[k]((uint32_t*)v->pos, v->vel_max, n, celdas, largo); break;
+        }
+        return;
+    }
+    switch (v->bytes_pos) {
+        case 1:  MOVER_COMPACTO_u8_i64[k]((uint8_t*)v->pos, v->vel_max, v->n, celdas, road_len);   break;
+        case 2:  MOVER_COMPACTO_u16_i64[k]((uint16_t*)v->pos, v->vel_max, v->n, celdas, road_len); break;
+        case 4:  MOVER_COMPACTO_u32_i64[k]((uint32_t*)v->pos, v->vel_max, v->n, celdas, road_len); break;
+        default: MOVER_COMPACTO_u64_i64[k]((uint64_t*)v->pos, v->vel_max, v->n, celdas, road_len); break;
+    }
+}
+
+// Deja en celdas el estado tras k actualizaciones, sabiendo que tiene el de
+// k_ant: sólo escriben los semáforos que cambiaron, con un xor atómico porque
+// dieciséis celdas comparten palabra. Con la ubicación de posicion_semaforo el
+// dueño de cada celda (el de menor índice, como en celda_sem) es j < largo.
+static void publicar_celdas_compactas(const TablaCiclos *t, const int64_t *pos_sem, int64_t road_len,
+                                      long long k_ant, long long k, uint32_t *celdas) {
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < t->n_sem; j++) {
+        if (j >= road_len) continue;
+        unsigned char antes = (k_ant < 0) ? VERDE : estado_en_tick(t, j, k_ant);
+        unsigned char ahora = estado_en_tick(t, j, k);
+        if (antes == ahora) continue;
+        int64_t c = pos_sem[j];
+        uint32_t delta = ((antes ^ ahora) & 3u) << (2 * (c & 15));
+        #pragma omp atomic
+        celdas[c >> 4] ^= delta;
+    }
+}
+
+// Mismo resultado que trafico_simular_simple. Parte de Semaforo[] recién inicializado
+// (sin celda_sem) y lo deja sincronizado al final; las posiciones de los
+// semáforos salen de posicion_semaforo para admitir largos de 64 bits.
+// Con índices de 64 bits no hay salida por tick.
+void trafico_simular_compacto(int iteraciones, VehiculosCompactos *vc, Semaforo *s, int n_sem, int64_t road_len, int delay_seg, Salida *out, Metricas *met) {
+    VehiculosCompactos v = *vc;
+    TablaCiclos tabla;
+    int con_salida = (out->tipo != SALIDA_NINGUNA && !v.indices_64);
+    uint32_t *celdas = (uint32_t*)calloc(((size_t)road_len + 15) / 16, sizeof(uint32_t));
+    int64_t *pos_sem = (int64_t*)malloc(sizeof(int64_t) * n_sem);
+    unsigned char *estado = (unsigned char*)malloc(n_sem);
+    // Posiciones por id para la salida, sólo si hay salida
+    int *pos_salida = con_salida ? (int*)malloc(sizeof(int) * (size_t)v.n) : NULL;
+    if (!celdas || !pos_sem || !estado || (con_salida && !pos_salida) ||
+        crear_tabla_ciclos(&tabla, s, n_sem) != 0) {
+        fprintf(stderr, "Sin memoria para el motor compacto\n");
+        free(celdas); free(pos_sem); free(estado); free(pos_salida);
+        return;
+    }
+    for (int j = 0; j < n_sem; j++) pos_sem[j] = posicion_semaforo(j, n_sem, road_len);
+    publicar_celdas_compactas(&tabla, pos_sem, road_len, -1, 0, celdas);
+
+    for (int i = 0; i < iteraciones; i++) {
+        double inicio = omp_get_wtime(), marca = inicio;
+        long long k = (long long)i + 1;
+        publicar_celdas_compactas(&tabla, pos_sem, road_len, k - 1, k, celdas);
+        medir_fase(met, i, FASE_SNAPSHOT, &marca);
+
+        mover_vehiculos_compactos(&v, celdas, road_len);
+        medir_fase(met, i, FASE_MOVIMIENTO, &marca);
+
+        if (con_salida && toca_emitir(out, i)) {
+            int n_veh = (int)v.n;
+            #pragma omp parallel for schedule(static)
+            for (int q = 0; q < n_veh; q++) {
+                pos_salida[q] = (v.bytes_pos == 1) ? ((const uint8_t*)v.pos)[q]
+                              : (v.bytes_pos == 2) ? ((const uint16_t*)v.pos)[q]
+                              : (int)((const uint32_t*)v.pos)[q];
+            }
+            estados_en_tick(&tabla, k, estado);
+            trafico_emitir_estado(out, pos_salida, 1, n_veh, estado, n_sem, i);
+        }
+        medir_fase(met, i, FASE_SALIDA, &marca);
+        if (delay_seg > 0) SLEEP_SEC(delay_seg);
+        medir_fase(met, i, FASE_DELAY, &marca);
+        sumar_fase(met, i, FASE_TICK, marca - inicio);
+    }
+    sincronizar_semaforos(&tabla, s, iteraciones);
+    liberar_tabla_ciclos(&tabla);
+    free(celdas); free(pos_sem); free(estado); free(pos_salida);
+}
+
+
+// -------------------- API de la biblioteca (trafico.h) --------------------
+// El manejador guarda el estado de trafico_simular_simple / trafico_simular_dinamico, que
+// vive entero en Vehiculo[] y Semaforo[]: cada trafico_avanzar sigue desde ahí
+// con el mismo resultado que una sola corrida larga.
+_Static_assert(sizeof(EstadoSemaforo) == sizeof(int), "trafico_estados lee EstadoSemaforo como int");
+_Static_assert(TRAFICO_ROJO == ROJO && TRAFICO_VERDE == VERDE && TRAFICO_AMARILLO == AMARILLO,
+               "estados de trafico.h");
+
+struct Trafico {
+    Vehiculo *veh;
+    Semaforo *sem;
+    int *celda_sem;
+    int n_veh;
+    int n_sem;
+    int largo;
+    int usar_secciones;
+    long long tick;
+    unsigned int semilla;
+    Escenario esc;          // cargado de un escenario: veh y sem son suyos
+    ArchivoMapeado mapa;    // cargado de un punto de control: veh y sem apuntan al mapeo
+};
+
+Trafico *trafico_crear(const TraficoConfig *cfg) {
+    if (!cfg || cfg->n_vehiculos <= 0 || cfg->n_semaforos <= 0 || cfg->largo <= 2 || cfg->ciclo <= 0) return NULL;
+    if (!isa_elegida) trafico_elegir_isa(NULL);
+    Trafico *t = (Trafico*)calloc(1, sizeof(Trafico));
+    if (!t) return NULL;
+    t->n_veh = cfg->n_vehiculos;
+    t->n_sem = cfg->n_semaforos;
+    t->largo = cfg->largo;
+    t->usar_secciones = cfg->usar_secciones;
+    t->semilla = cfg->semilla;
+    t->veh = (Vehiculo*)malloc(sizeof(Vehiculo) * t->n_veh);
+    t->sem = (Semaforo*)malloc(sizeof(Semaforo) * t->n_sem);
+    t->celda_sem = (int*)malloc(sizeof(int) * t->largo);
+    if (!t->veh || !t->sem || !t->celda_sem) {
+        trafico_destruir(t);
+        return NULL;
+    }
+    trafico_inicializar_vehiculos(t->veh, t->n_veh, t->largo, t->semilla);
+    trafico_inicializar_semaforos(t->sem, t->n_sem, t->largo, cfg->ciclo, t->celda_sem);
+    return t;
+}
+
+Trafico *trafico_cargar(const char *ruta, int usar_secciones) {
+    if (!isa_elegida) trafico_elegir_isa(NULL);
+    Trafico *t = (Trafico*)calloc(1, sizeof(Trafico));
+    if (!t) return NULL;
+    t->usar_secciones = usar_secciones;
+    ArchivoMapeado m;
+    if (trafico_mapear_archivo(&m, ruta) == 0 && m.bytes >= 4 && memcmp(m.base, ESTADO_MAGIC_CONTROL, 4) == 0) {
+        const CabeceraEstado *c = trafico_validar_archivo_estado(&m, ESTADO_MAGIC_CONTROL);
+        t->mapa = m;
+        if (!c) {
+            trafico_destruir(t);
+            return NULL;
+        }
+        t->veh = (Vehiculo*)(m.base + c->off_vehiculos);
+        t->sem = (Semaforo*)(m.base + c->off_semaforos);
+        t->n_veh = (int)c->n_veh;
+        t->n_sem = (int)c->n_sem;
+        t->largo = (int)c->largo;
+        t->tick = (long long)c->tick;
+        t->semilla = c->semilla;
+    } else {
+        if (m.base) trafico_desmapear_archivo(&m);
+        if (trafico_cargar_escenario(&t->esc, ruta) != 0) {
+            free(t);
+            return NULL;
+        }
+        t->veh = t->esc.veh;
+        t->sem = t->esc.sem;
+        t->n_veh = t->esc.n_veh;
+        t->n_sem = t->esc.n_sem;
+        t->largo = t->esc.largo;
+    }
+    t->celda_sem = (int*)malloc(sizeof(int) * t->largo);
+    if (!t->celda_sem) {
+        trafico_destruir(t);
+        return NULL;
+    }
+    trafico_construir_celda_sem(t->sem, t->n_sem, t->largo, t->celda_sem);
+    return t;
+}
+
+int trafico_avanzar(Trafico *t, int n) {
+    if (!t || n < 0) return -1;
+    Salida nula;
+    memset(&nula, 0, sizeof(nula));
+    nula.tipo = SALIDA_NINGUNA;
+    int r = t->usar_secciones
+          ? trafico_simular_dinamico(n, t->veh, t->n_veh, t->sem, t->n_sem, t->celda_sem, t->largo, 0, 1, 0, NULL, &nula, NULL)
+          : trafico_simular_simple(n, t->veh, t->n_veh, t->sem, t->n_sem, t->celda_sem, t->largo, 0, &nula, NULL);
+    if (r != 0) return -1;
+    t->tick += n;
+    return 0;
+}
+
+int trafico_guardar(const Trafico *t, const char *ruta) {
+    if (!t) return -1;
+    return trafico_escribir_archivo_estado(ruta, ESTADO_MAGIC_CONTROL, t->veh, t->n_veh, t->sem, t->n_sem, t->largo,
+                                           t->tick, t->semilla);
+}
+
+void trafico_destruir(Trafico *t) {
+    if (!t) return;
+    if (t->mapa.base) {
+        trafico_desmapear_archivo(&t->mapa);
+    } else if (t->esc.veh || t->esc.sem) {
+        trafico_liberar_escenario(&t->esc);
+    } else {
+        free(t->veh);
+        free(t->sem);
+    }
+    free(t->celda_sem);
+    free(t);
+}
+
+long long trafico_tick(const Trafico *t)    { return t->tick; }
+int trafico_n_vehiculos(const Trafico *t)   { return t->n_veh; }
+int trafico_n_semaforos(const Trafico *t)   { return t->n_sem; }
+int trafico_largo(const Trafico *t)         { return t->largo; }
+
+const int *trafico_posiciones(const Trafico *t, size_t *paso) {
+    *paso = PASO_VEHICULO;
+    return (t->n_veh > 0) ? &t->veh[0].pos : NULL;
+}
+
+const int *trafico_estados(const Trafico *t, size_t *paso) {
+    *paso = sizeof(Semaforo) / sizeof(int);
+    return (t->n_sem > 0) ? (const int*)&t->sem[0].estado : NULL;
+}
@@ -0,0 +1,70 @@
+#ifndef TRAFICO_H
+#define TRAFICO_H
+
+// -------------------- Biblioteca de simulación --------------------
+// La simulación de trafico.c detrás de un manejador opaco, para avanzarla
+// desde un bucle propio sin pasar por la salida de texto: se crea (o se carga
+// de un escenario o punto de control), se avanza de a n ticks y se leen las
+// posiciones y los estados de semáforo directo de sus arreglos, sin copiar.
+//
+// Compilación (OpenMP es obligatorio):
+//   gcc -O2 -fopenmp -c trafico.c                          objeto para enlazar
+//   gcc -O2 -fopenmp simulacion_secuencial.c trafico.c -o simulacion_secuencial
+//   gcc -O2 -fopenmp simulacion_paralela.c trafico.c -o simulacion_paralela
+//
+// Los punteros de trafico_posiciones y trafico_estados valen hasta
+// trafico_destruir y reflejan cada trafico_avanzar; el elemento k está en
+// p[k * paso]. No se deben leer mientras otro hilo avanza la simulación.
+
+#include <stddef.h>
+
+typedef struct Trafico Trafico;
+
+typedef struct {
+    int n_vehiculos;
+    int n_semaforos;
+    int largo;              // celdas del bucle (> 2)
+    int ciclo;              // ticks del ciclo: verde 50%, amarillo 20%, rojo el resto
+    unsigned int semilla;
+    int usar_secciones;     // 1: semáforos y movimiento solapados, el movimiento ve el estado previo
+} TraficoConfig;
+
+// Valores de trafico_estados
+#define TRAFICO_ROJO     0
+#define TRAFICO_VERDE    1
+#define TRAFICO_AMARILLO 2
+
+// NULL si la configuración es inválida o no hay memoria
+Trafico *trafico_crear(const TraficoConfig *cfg);
+
+// Escenario (texto o binario, ver --escenario) o punto de control (--punto-control).
+// Los binarios se mapean y se usan sin copiar. NULL si el archivo no es válido.
+Trafico *trafico_cargar(const char *ruta, int usar_secciones);
+
+// Avanza n ticks; 0 si pudo, -1 sin memoria (el estado y el tick no cambian)
+int trafico_avanzar(Trafico *t, int n);
+
+// Punto de control con el estado actual (se puede reanudar con trafico_cargar
+// o con --reanudar); 0 si pudo
+int trafico_guardar(const Trafico *t, const char *ruta);
+
+void trafico_destruir(Trafico *t);
+
+// Variante de los kernels de movimiento y semáforos para todo el proceso:
+// NULL o "auto" elige la mejor que soporte la CPU (lo hace trafico_crear si
+// nadie eligió antes); "base", "sse4.2", "avx2" o "avx512" la fuerzan.
+// -1 si el nombre no existe o la CPU no la soporta. No llamar mientras
+// otro hilo avanza una simulación.
+int trafico_elegir_isa(const char *nombre);
+const char *trafico_isa(void);
+
+long long trafico_tick(const Trafico *t);
+int trafico_n_vehiculos(const Trafico *t);
+int trafico_n_semaforos(const Trafico *t);
+int trafico_largo(const Trafico *t);
+
+// Posición del vehículo k (por id) y estado del semáforo j; NULL si no hay ninguno
+const int *trafico_posiciones(const Trafico *t, size_t *paso);
+const int *trafico_estados(const Trafico *t, size_t *paso);
+
+#endif
@@ -0,0 +1,355 @@
+#ifndef TRAFICO_INTERNO_H
+#define TRAFICO_INTERNO_H
+
+// -------------------- Interno de trafico.c --------------------
+// Tipos y motores de trafico.c que usa la línea de comandos
+// (simulacion_paralela.c) además de la API pública de trafico.h. No es parte
+// de la biblioteca: cambia junto con trafico.c. Lleva el prefijo trafico_ para
+// no chocar con los símbolos de quien enlace trafico.o y, con GCC o Clang,
+// visibilidad oculta para no exportarse desde una biblioteca compartida.
+// Lo que no está acá es static en trafico.c.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include "trayectoria.h"
+#include "trafico.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+  #include <windows.h>
+#endif
+
+#if defined(__GNUC__) && !(defined(_WIN32) || defined(_WIN64))
+  #pragma GCC visibility push(hidden)
+#endif
+
+// -------------------- Estructuras --------------------
+typedef enum {
+    ROJO = 0,
+    VERDE = 1,
+    AMARILLO = 2
+} EstadoSemaforo;
+
+typedef struct {
+    int id;
+    int pos;            // posición sobre una carretera 1D [0, road_len)
+    EstadoSemaforo estado;
+    int t_en_estado;    // tiempo transcurrido en el estado actual (ticks)
+    // Duraciones configurables por estado:
+    int dur_rojo;
+    int dur_verde;
+    int dur_amarillo;
+} Semaforo;
+
+typedef struct {
+    int id;
+    int pos;        // posición actual
+    int vel_max;    // velocidad máxima (celdas por tick)
+} Vehiculo;
+
+typedef struct {
+    int largo;          // largo de la carretera (bucle 1D) o del tramo en una Red
+    Vehiculo *vehiculos;
+    int n_veh;
+    Semaforo *semaforos;
+    int n_sem;
+} Interseccion; 
+
+// Estado publicado de los semáforos, 1 byte por semáforo, en doble buffer:
+// buf[act] es el último estado completo y buf[1 - act] lo escribe la fase de
+// semáforos del tick en curso. Al final del tick se intercambian los papeles.
+typedef struct {
+    unsigned char *buf[2];
+    int act;
+} EstadoSemaforos;
+
+// Memoria alineada a línea de caché para los arreglos SoA
+#define ALINEACION_BYTES 64
+
+// -------------------- Inicialización --------------------
+void trafico_inicializar_vehiculos(Vehiculo *v, int n, int road_len, unsigned int seed);
+void trafico_construir_celda_sem(const Semaforo *s, int n, int road_len, int *celda_sem);
+void trafico_inicializar_semaforos(Semaforo *s, int n, long long road_len, int ciclo_total, int *celda_sem);
+
+// -------------------- Vehículos en SoA (kernel vectorizado) --------------------
+#define VEH_SOA_BLOQUE (ALINEACION_BYTES / (int)sizeof(int))
+
+typedef struct {
+    int *pos;       // posición actual
+    int *vel_max;   // velocidad máxima (0 en el relleno)
+    int *id;        // id del vehículo en cada índice (cambia si se reordena)
+    int n;          // vehículos reales
+    int n_pad;      // n redondeado a múltiplo de VEH_SOA_BLOQUE
+} VehiculosSoA;
+
+int trafico_crear_vehiculos_soa(VehiculosSoA *v, int n);
+void trafico_liberar_vehiculos_soa(VehiculosSoA *v);
+void trafico_vehiculos_a_soa(const Vehiculo *src, VehiculosSoA *v);
+
+// -------------------- Orden por posición --------------------
+typedef struct {
+    int periodo;            // ticks entre mediciones de desorden
+    int hilos;              // equipo del radix (tamaño de hist)
+    int *pos, *vel_max, *id;// destino de cada pasada, se intercambia con VehiculosSoA
+    size_t *hist;           // hilos * RADIX_CUBETAS
+    int *pos_por_id;        // posiciones indexadas por id, para la salida
+    int reordenado;         // 0 mientras id[i] == i
+    long long reordenamientos;
+} OrdenVehiculos;
+
+int trafico_crear_orden_vehiculos(OrdenVehiculos *o, const VehiculosSoA *v, int periodo);
+void trafico_liberar_orden_vehiculos(OrdenVehiculos *o);
+
+// -------------------- Salida --------------------
+typedef enum {
+    SALIDA_TEXTO = 0,   // imprimir_estado por stdout
+    SALIDA_BINARIA,     // frames de trayectoria.h (ver decodificar_trayectoria.c)
+    SALIDA_NINGUNA
+} TipoSalida;
+
+// Copia de un tick para el hilo escritor (posiciones compactadas, paso 1)
+typedef struct {
+    int iter;
+    int *pos;
+    unsigned char *estado;
+} FrameSalida;
+
+// Anillo productor/consumidor entre la simulación y el hilo escritor.
+// producidos y consumidos sólo crecen; el frame k vive en frames[k % capacidad].
+// Cada contador lo escribe un solo lado y se publica con atomics seq_cst,
+// que en OpenMP implican el flush de los datos del frame.
+typedef struct {
+    FrameSalida *frames;
+    int capacidad;          // 0 = salida síncrona dentro del tick
+    int descartar;          // con el anillo lleno: 1 descarta el frame, 0 bloquea
+    long long producidos;
+    long long consumidos;
+    long long descartados;
+    int cerrada;
+} ColaSalida;
+
+typedef struct {
+    TipoSalida tipo;
+    Trayectoria tray;   // sólo con SALIDA_BINARIA
+    ColaSalida cola;
+    int n_veh;
+    int n_sem;
+    int cada;           // con cada > 1 sólo se emiten los ticks múltiplos de cada...
+    int ultimo;         // ...y el último tick de la corrida
+} Salida;
+
+int trafico_crear_cola_salida(Salida *out, int capacidad, int descartar);
+void trafico_liberar_cola_salida(Salida *out);
+void trafico_emitir_estado(Salida *out, const int *pos, size_t paso_pos, int n_veh, const unsigned char *estado, int n_sem, int iter);
+void trafico_cerrar_cola_salida(Salida *out);
+void trafico_drenar_cola_salida(Salida *out);
+
+// -------------------- Instrumentación por fase --------------------
+// Tiempos por tick y fase, en segundos: t[tick * N_FASES + fase].
+// Los motores reciben NULL cuando no se pidió reporte. Al reanudar un punto
+// de control sólo corren (y se reportan) los ticks [inicio, iteraciones).
+typedef struct {
+    double *t;
+    int iteraciones;
+    int inicio;
+} Metricas;
+
+int trafico_crear_metricas(Metricas *m, int iteraciones);
+void trafico_liberar_metricas(Metricas *m);
+int trafico_escribir_reporte(const Metricas *m, const char *ruta, const char *motor, long long n_veh, int n_sem, long long road_len, double t_total);
+
+// -------------------- Bucle de simulación --------------------
+// 0 si corrió; -1 sin memoria para el estado de los semáforos (nada avanzó)
+int trafico_simular_simple(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, Salida *out, Metricas *met);
+
+// -------------------- Archivos de estado --------------------
+// Contenedor binario de vehículos y semáforos, pensado para mapearse sin copiar:
+// las secciones son los Vehiculo[] y Semaforo[] tal como están en memoria,
+// alineados a 64 bytes, y la cabecera guarda sus tamaños y una marca de orden
+// de bytes para rechazar archivos de otra plataforma.
+//
+//   Cabecera (64 bytes)
+//     char magic[4]      "TRCK" punto de control, "TRES" escenario
+//     u16 version        ESTADO_VERSION
+//     u16 reservado
+//     u32 marca_orden    0x01020304 en el orden de bytes nativo
+//     u32 bytes_vehiculo, u32 bytes_semaforo
+//     u32 n_veh, u32 n_sem, u32 largo
+//     u64 tick           ticks ya simulados
+//     u32 semilla, u32 reservado
+//     u64 off_vehiculos, u64 off_semaforos (desde el inicio del archivo)
+#define ESTADO_MAGIC_CONTROL  "TRCK"
+#define ESTADO_MAGIC_ESCENARIO "TRES"
+#define ESTADO_VERSION        1
+#define ESTADO_MARCA_ORDEN    0x01020304u
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t reservado0;
+    uint32_t marca_orden;
+    uint32_t bytes_vehiculo;
+    uint32_t bytes_semaforo;
+    uint32_t n_veh;
+    uint32_t n_sem;
+    uint32_t largo;
+    uint64_t tick;
+    uint32_t semilla;
+    uint32_t reservado1;
+    uint64_t off_vehiculos;
+    uint64_t off_semaforos;
+} CabeceraEstado;
+
+// Archivo mapeado en privado (copia al escribir): las páginas que el motor
+// modifica se copian y el archivo no cambia
+typedef struct {
+    unsigned char *base;
+    size_t bytes;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE archivo;
+    HANDLE mapeo;
+#endif
+} ArchivoMapeado;
+
+int trafico_escribir_archivo_estado(const char *ruta, const char *magic, const Vehiculo *v, int n_veh, const Semaforo *s, int n_sem,
+                                    int road_len, long long tick, unsigned int semilla);
+int trafico_mapear_archivo(ArchivoMapeado *m, const char *ruta);
+void trafico_desmapear_archivo(ArchivoMapeado *m);
+const CabeceraEstado *trafico_validar_archivo_estado(const ArchivoMapeado *m, const char *magic);
+
+// -------------------- Puntos de control --------------------
+typedef struct {
+    const char *ruta;
+    int cada;               // ticks entre puntos de control (0: ninguno)
+    int inicio;             // primer tick a simular (al reanudar)
+    int asincrono;          // 1 si un hilo aparte llama a trafico_escribir_puntos_control
+    unsigned int semilla;
+    int largo;
+    int n_veh;
+    int n_sem;
+    Vehiculo *veh;          // copia del último punto pedido
+    Semaforo *sem;
+    long long tick;         // ticks simulados en la copia
+    int pendiente;          // la copia espera al escritor (atomics seq_cst)
+    int cerrado;
+    int error;
+} PuntoControl;
+
+int trafico_crear_punto_control(PuntoControl *pc, const char *ruta, int cada, int n_veh, int n_sem, int road_len, unsigned int semilla);
+void trafico_liberar_punto_control(PuntoControl *pc);
+void trafico_cerrar_punto_control(PuntoControl *pc);
+void trafico_escribir_puntos_control(PuntoControl *pc);
+
+// -------------------- Motores --------------------
+// Igual que trafico_simular_simple: 0 si corrió, -1 sin memoria
+int trafico_simular_dinamico(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, int usar_secciones,
+                             int ajuste_dinamico, PuntoControl *pc, Salida *out, Metricas *met);
+void trafico_simular_persistente(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, int usar_secciones, Salida *out, Metricas *met);
+void trafico_simular_soa(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg,
+                         OrdenVehiculos *orden, Salida *out, Metricas *met);
+void trafico_simular_analitico(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg,
+                               OrdenVehiculos *orden, Salida *out, Metricas *met);
+
+// -------------------- Conjunto de semillas --------------------
+typedef struct {
+    int *arena;
+    int *pos;               // n_rep * n_pad
+    int *vel_max;           // n_rep * n_pad, 0 en el relleno
+    const unsigned int *semillas;
+    int n_rep;
+    int n_veh;
+    int n_pad;              // n_veh redondeado a múltiplo de VEH_SOA_BLOQUE
+    long long *avance;      // celdas recorridas por réplica
+    long long *detenidos;   // vehículo-ticks frenados por un semáforo, por réplica
+} Conjunto;
+
+void trafico_liberar_conjunto(Conjunto *c);
+int trafico_crear_conjunto(Conjunto *c, const unsigned int *semillas, int n_rep, int n_veh, int road_len);
+// 0 si corrió; -1 sin memoria
+int trafico_simular_conjunto(int iteraciones, Conjunto *cj, const Semaforo *s, int n_sem, const int *celda_sem, int road_len, Metricas *met);
+void trafico_reportar_conjunto(const Conjunto *cj, int iteraciones, FILE *csv);
+
+// -------------------- Optimizador de onda verde --------------------
+typedef struct {
+    long long avance;       // celdas recorridas por todos los vehículos
+    long long detenidos;    // vehículo-ticks frenados por un semáforo
+} Puntaje;
+
+int trafico_optimizar_plan(Semaforo *plan, int n_sem, const int *celda_sem, const VehiculosSoA *v, int road_len, int iteraciones,
+                           int n_cand, int rondas, int paradas, int repartos, unsigned int seed, Puntaje *mejor);
+
+// -------------------- Escenarios --------------------
+typedef struct {
+    Vehiculo *veh;
+    Semaforo *sem;
+    int n_veh;
+    int n_sem;
+    int largo;
+    ArchivoMapeado mapa;    // binario: veh y sem apuntan adentro del mapeo
+} Escenario;
+
+void trafico_liberar_escenario(Escenario *e);
+int trafico_cargar_escenario(Escenario *e, const char *ruta);
+int trafico_escribir_escenario_texto(const char *ruta, const char *titulo, int road_len, const Semaforo *s, int n_sem,
+                                     const VehiculosSoA *v);
+
+// -------------------- Motores por eventos, con exclusión y con carriles --------------------
+void trafico_simular_eventos(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, Salida *out, Metricas *met);
+int trafico_posiciones_crecientes(const Vehiculo *v, int n);
+void trafico_simular_exclusion(int iteraciones, VehiculosSoA *v, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg,
+                               double frenado, unsigned int seed, Salida *out, Metricas *met);
+// Cambios de carril de la corrida, -1 sin memoria
+long long trafico_simular_carriles(int iteraciones, const Vehiculo *v, int n_veh, int carriles, Semaforo *s, int n_sem, const int *celda_sem,
+                                   int road_len, int delay_seg, double frenado, unsigned int seed, Salida *out, Metricas *met);
+
+// -------------------- Red de calles --------------------
+typedef struct {
+    int n_nodos;
+    int n_tramos;
+    int *fila;              // n_nodos + 1
+    int *col;               // índices de tramo
+    int *destino;           // nodo de llegada de cada tramo
+    int *base;              // n_tramos + 1: primera celda de cada tramo en la numeración global
+    Interseccion *tramos;
+    Semaforo *sem;          // los semáforos de todos los tramos
+    Vehiculo *veh, *veh_sig;// agrupados por tramo (veh_sig: destino del reagrupado)
+    int *tramo_sig;         // tramo de cada vehículo de veh tras el paso
+    int *inicio;            // n_tramos + 1: grupo de cada tramo en veh
+    int *cuenta;            // hilos * n_tramos, para el reagrupado
+    int hilos;
+    int n_veh;
+} Red;
+
+void trafico_liberar_red(Red *r);
+int trafico_crear_red_grilla(Red *r, int filas, int cols, int largo, int n_veh, const Semaforo *modelo, unsigned int seed);
+// 0 si corrió; -1 sin memoria
+int trafico_simular_red(int iteraciones, Red *r, unsigned int seed, int delay_seg, Salida *out, Metricas *met);
+
+// -------------------- Descomposición por dominios --------------------
+void trafico_simular_dominios(int iteraciones, Vehiculo *v, int n_veh, Semaforo *s, int n_sem, const int *celda_sem, int road_len, int delay_seg, Salida *out, Metricas *met);
+
+// -------------------- Codificación compacta --------------------
+#define LIMITE_INDICE_32 (INT_MAX - 8)   // margen para pos + vel_max
+
+static inline int requiere_indices_64(int64_t n_veh, int64_t largo) {
+    return n_veh > LIMITE_INDICE_32 || largo > LIMITE_INDICE_32;
+}
+
+typedef struct {
+    void *pos;          // uint8_t/uint16_t/uint32_t/uint64_t según bytes_pos
+    uint8_t *vel_max;
+    int64_t n;
+    int bytes_pos;
+    int indices_64;     // kernels con índice int64_t
+} VehiculosCompactos;
+
+int trafico_crear_vehiculos_compactos(VehiculosCompactos *v, int64_t n, int64_t road_len, unsigned int seed);
+void trafico_liberar_vehiculos_compactos(VehiculosCompactos *v);
+void trafico_simular_compacto(int iteraciones, VehiculosCompactos *vc, Semaforo *s, int n_sem, int64_t road_len, int delay_seg, Salida *out, Metricas *met);
+
+#if defined(__GNUC__) && !(defined(_WIN32) || defined(_WIN64))
+  #pragma GCC visibility pop
+#endif
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef TRAYECTORIA_H
+#define TRAYECTORIA_H
+
+// -------------------- Formato binario de trayectorias --------------------
+// Reemplaza la salida de texto de imprimir_estado por frames compactos.
+// Todo en little-endian:
+//
+//   Cabecera (20 bytes)
+//     "TRAY"            magic
+//     u16 version       TRAY_VERSION
+//     u8  bytes_pos     1, 2 o 4: el ancho mínimo que cubre [0, largo)
+//     u8  bits_estado   2
+//     u32 n_veh, u32 n_sem, u32 largo
+//
+//   Frame (uno por tick emitido, ver --cada)
+//     u32 iter                      tick (0-based, el texto muestra iter + 1)
+//     n_veh * bytes_pos             posiciones por id de vehículo
+//     ceil(n_sem / 4) bytes         estados de 2 bits, el semáforo j en los
+//                                   bits 2*(j%4) del byte j/4
+//
+// Header-only para que cada ejecutable siga compilando con un solo comando.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define TRAY_MAGIC        "TRAY"
+#define TRAY_VERSION      1
+#define TRAY_BYTES_CABECERA 20
+
+// La codificación se reparte entre hilos sólo si se compila con OpenMP
+#ifdef _OPENMP
+  #define TRAY_OMP_FOR _Pragma("omp parallel for schedule(static)")
+#else
+  #define TRAY_OMP_FOR
+#endif
+
+typedef struct {
+    FILE *f;
+    int n_veh;
+    int n_sem;
+    int largo;
+    int bytes_pos;
+    size_t bytes_frame;     // sin contar el u32 de iter
+    unsigned char *buf;     // frame codificado (escritura) o crudo (lectura)
+} Trayectoria;
+
+static inline void tray_put_u32(unsigned char *p, uint32_t x) {
+    p[0] = (unsigned char)x;
+    p[1] = (unsigned char)(x >> 8);
+    p[2] = (unsigned char)(x >> 16);
+    p[3] = (unsigned char)(x >> 24);
+}
+
+static inline uint32_t tray_get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int tray_bytes_pos(int largo) {
+    if (largo <= 0x100) return 1;
+    if (largo <= 0x10000) return 2;
+    return 4;
+}
+
+static inline void tray_dimensionar(Trayectoria *t) {
+    t->bytes_pos = tray_bytes_pos(t->largo);
+    t->bytes_frame = (size_t)t->n_veh * t->bytes_pos + ((size_t)t->n_sem + 3) / 4;
+}
+
+// -------------------- Escritura --------------------
+// Devuelve 0 si la cabecera quedó escrita.
+static inline int tray_abrir_escritura(Trayectoria *t, const char *ruta, int n_veh, int n_sem, int largo) {
+    memset(t, 0, sizeof(*t));
+    t->n_veh = n_veh;
+    t->n_sem = n_sem;
+    t->largo = largo;
+    tray_dimensionar(t);
+    t->f = fopen(ruta, "wb");
+    t->buf = (unsigned char*)malloc(t->bytes_frame);
+    if (!t->f || !t->buf) {
+        if (t->f) fclose(t->f);
+        free(t->buf);
+        t->f = NULL;
+        t->buf = NULL;
+        return -1;
+    }
+    unsigned char cab[TRAY_BYTES_CABECERA];
+    memcpy(cab, TRAY_MAGIC, 4);
+    cab[4] = (unsigned char)(TRAY_VERSION & 0xFF);
+    cab[5] = (unsigned char)(TRAY_VERSION >> 8);
+    cab[6] = (unsigned char)t->bytes_pos;
+    cab[7] = 2;
+    tray_put_u32(cab + 8, (uint32_t)n_veh);
+    tray_put_u32(cab + 12, (uint32_t)n_sem);
+    tray_put_u32(cab + 16, (uint32_t)largo);
+    return (fwrite(cab, 1, sizeof(cab), t->f) == sizeof(cab)) ? 0 : -1;
+}
+
+// pos se lee con paso_pos ints entre vehículos: 1 para un arreglo SoA,
+// sizeof(Vehiculo)/sizeof(int) apuntando a &v[0].pos para el arreglo clásico.
+static inline int tray_escribir_frame(Trayectoria *t, int iter, const int *pos, size_t paso_pos, const unsigned char *estado) {
+    unsigned char *p = t->buf;
+    int bp = t->bytes_pos;
+    TRAY_OMP_FOR
+    for (int i = 0; i < t->n_veh; i++) {
+        uint32_t x = (uint32_t)pos[(size_t)i * paso_pos];
+        unsigned char *q = p + (size_t)i * bp;
+        q[0] = (unsigned char)x;
+        if (bp > 1) q[1] = (unsigned char)(x >> 8);
+        if (bp > 2) {
+            q[2] = (unsigned char)(x >> 16);
+            q[3] = (unsigned char)(x >> 24);
+        }
+    }
+    unsigned char *e = p + (size_t)t->n_veh * bp;
+    int n_bytes_est = (t->n_sem + 3) / 4;
+    TRAY_OMP_FOR
+    for (int b = 0; b < n_bytes_est; b++) {
+        unsigned char byte = 0;
+        for (int k = 0; k < 4 && 4 * b + k < t->n_sem; k++) {
+            byte |= (unsigned char)((estado[4 * b + k] & 3u) << (2 * k));
+        }
+        e[b] = byte;
+    }
+    unsigned char it[4];
+    tray_put_u32(it, (uint32_t)iter);
+    if (fwrite(it, 1, 4, t->f) != 4) return -1;
+    return (fwrite(p, 1, t->bytes_frame, t->f) == t->bytes_frame) ? 0 : -1;
+}
+
+static inline int tray_cerrar(Trayectoria *t) {
+    int r = 0;
+    if (t->f && fclose(t->f) != 0) r = -1;
+    free(t->buf);
+    t->f = NULL;
+    t->buf = NULL;
+    return r;
+}
+
+// -------------------- Lectura --------------------
+// Valida la cabecera. Devuelve 0 si el archivo es una trayectoria legible.
+static inline int tray_abrir_lectura(Trayectoria *t, const char *ruta) {
+    memset(t, 0, sizeof(*t));
+    t->f = fopen(ruta, "rb");
+    if (!t->f) return -1;
+    unsigned char cab[TRAY_BYTES_CABECERA];
+    if (fread(cab, 1, sizeof(cab), t->f) != sizeof(cab) || memcmp(cab, TRAY_MAGIC, 4) != 0 ||
+        (cab[4] | (cab[5] << 8)) != TRAY_VERSION || cab[7] != 2) {
+        fclose(t->f);
+        t->f = NULL;
+        return -1;
+    }
+    t->n_veh = (int)tray_get_u32(cab + 8);
+    t->n_sem = (int)tray_get_u32(cab + 12);
+    t->largo = (int)tray_get_u32(cab + 16);
+    tray_dimensionar(t);
+    if (t->bytes_pos != cab[6]) {
+        fclose(t->f);
+        t->f = NULL;
+        return -1;
+    }
+    t->buf = (unsigned char*)malloc(t->bytes_frame > 0 ? t->bytes_frame : 1);
+    if (!t->buf) {
+        fclose(t->f);
+        t->f = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Lee el siguiente frame. Devuelve 1 si leyó uno, 0 al final del archivo
+// y -1 si el archivo está truncado.
+static inline int tray_leer_frame(Trayectoria *t, int *iter, int *pos, unsigned char *estado) {
+    unsigned char it[4];
+    size_t n = fread(it, 1, 4, t->f);
+    if (n == 0) return 0;
+    if (n != 4 || fread(t->buf, 1, t->bytes_frame, t->f) != t->bytes_frame) return -1;
+    *iter = (int)tray_get_u32(it);
+    const unsigned char *p = t->buf;
+    int bp = t->bytes_pos;
+    for (int i = 0; i < t->n_veh; i++) {
+        const unsigned char *q = p + (size_t)i * bp;
+        uint32_t x = q[0];
+        if (bp > 1) x |= (uint32_t)q[1] << 8;
+        if (bp > 2) x |= ((uint32_t)q[2] << 16) | ((uint32_t)q[3] << 24);
+        pos[i] = (int)x;
+    }
+    const unsigned char *e = p + (size_t)t->n_veh * bp;
+    for (int j = 0; j < t->n_sem; j++) {
+        estado[j] = (unsigned char)((e[j / 4] >> (2 * (j % 4))) & 3u);
+    }
+    return 1;
+}
+
+#endif